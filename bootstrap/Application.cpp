@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include <iostream>
 #include "Input.h"
+#include "Texture.h"
 #include "imgui_glfw3.h"
 
 namespace aie {
@@ -57,6 +58,8 @@ bool Application::createWindow(const char* title, int width, int height, bool fu
 
 void Application::destroyWindow() {
 
+	Texture::stopAsyncLoads();
+
 	ImGui_Shutdown();
 	Input::destroy();
 
@@ -107,6 +110,9 @@ void Application::run(const char* title, int width, int height, bool fullscreen)
 				fpsInterval -= 1.0f;
 			}
 
+			// swap in textures that have finished loading
+			Texture::updateAsyncLoads();
+
 			// clear imgui
 			ImGui_NewFrame();
 
@@ -6,6 +6,7 @@ namespace aie {
 class Font {
 
 	friend class Renderer2D;
+	friend class Gizmos;
 
 public:
 
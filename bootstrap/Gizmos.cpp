@@ -1,181 +1,2113 @@
 #include "Gizmos.h"
+#include "Font.h"
+#include "ShaderProgram.h"
 #include "gl_core_4_4.h"
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 #include <iostream>
+#include <string.h>
+#include <stb_truetype.h>
+
+#ifndef AIE_GIZMOS_DISABLED
 
 namespace aie {
 
 Gizmos* Gizmos::sm_singleton = nullptr;
+thread_local Gizmos::ThreadLayers Gizmos::sm_threadLayers = {};
+unsigned int Gizmos::sm_generation = 0;
+thread_local unsigned int Gizmos::sm_channel = 0;
+
+// colours are stored as normalised bytes
+static inline unsigned char toByte(float value) {
+	return (unsigned char)(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+void Gizmos::setVertex(GizmoVertex& vertex, float x, float y, float z, const glm::vec4& colour) {
+	vertex.x = x;
+	vertex.y = y;
+	vertex.z = z;
+	vertex.r = toByte(colour.r);
+	vertex.g = toByte(colour.g);
+	vertex.b = toByte(colour.b);
+	vertex.a = toByte(colour.a);
+}
+
+// fragment shader shared by all gizmo programs
+static const char* sm_fragmentSource = "#version 150\n \
+					 in vec4 vColour; \
+                     out vec4 FragColor; \
+					 void main()	{ FragColor = vColour; }";
+
+// weighted, blended order-independent transparency. fragments add to an accumulation target with
+// a weight that favours nearer and more opaque ones, and multiply down how much of the background
+// is revealed. the weight is the one suggested by McGuire and Bavoil
+static const char* sm_weightedFragmentSource = "#version 150\n \
+					 in vec4 vColour; \
+					 out vec4 Accumulation; \
+					 out float Revealage; \
+					 void main() { \
+					 float weight = clamp(pow(min(1.0, vColour.a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 0.01, 3000.0); \
+					 Accumulation = vec4(vColour.rgb * vColour.a, vColour.a) * weight; \
+					 Revealage = vColour.a; }";
+
+// averages the accumulated colours and blends them over the background by how little is revealed
+static const char* sm_resolveFragmentSource = "#version 150\n \
+					 uniform sampler2D Accumulation; \
+					 uniform sampler2D Revealage; \
+					 uniform ivec2 Origin; \
+					 out vec4 FragColor; \
+					 void main() { ivec2 p = ivec2(gl_FragCoord.xy) - Origin; \
+					 float revealage = texelFetch(Revealage, p, 0).r; \
+					 if (revealage == 1.0) discard; \
+					 vec4 accumulation = texelFetch(Accumulation, p, 0); \
+					 FragColor = vec4(accumulation.rgb / clamp(accumulation.a, 1e-4, 5e4), revealage); }";
+
+// every Gizmo shader shares these locations, so the vertex arrays work with any of them
+static void bindLocations(unsigned int program) {
+	glBindAttribLocation(program, 0, "Position");
+	glBindAttribLocation(program, 1, "Colour");
+	glBindAttribLocation(program, 2, "Transform");
+	glBindAttribLocation(program, 6, "Params");
+	glBindAttribLocation(program, 7, "Expiry");
+	glBindAttribLocation(program, 2, "Start");
+	glBindAttribLocation(program, 3, "End");
+	glBindAttribLocation(program, 4, "Style");
+	glBindAttribLocation(program, 2, "Control0");
+	glBindAttribLocation(program, 3, "Control1");
+	glBindAttribLocation(program, 4, "Control2");
+	glBindAttribLocation(program, 5, "Control3");
+	glBindAttribLocation(program, 6, "Segments");
+	glBindAttribLocation(program, 2, "Offset");
+	glBindAttribLocation(program, 3, "TexCoords");
+	glBindFragDataLocation(program, 0, "Accumulation");
+	glBindFragDataLocation(program, 1, "Revealage");
+}
+
+static unsigned int createProgram(const char* vsSource, const char* fsSource) {
+	return createShaderProgram(vsSource, fsSource, "Gizmo", bindLocations);
+}
+
+// frustum planes from the rows of a projection-view, pointing inwards
+static void getFrustum(const glm::mat4& m, float planes[6][4]) {
+	for (int i = 0; i < 6; ++i) {
+		int row = i / 2;
+		float sign = i % 2 == 0 ? 1.0f : -1.0f;
+
+		glm::vec4 plane(m[0][3] + sign * m[0][row],
+						m[1][3] + sign * m[1][row],
+						m[2][3] + sign * m[2][row],
+						m[3][3] + sign * m[3][row]);
+		plane /= glm::length(glm::vec3(plane));
+
+		memcpy(planes[i], glm::value_ptr(plane), sizeof(float) * 4);
+	}
+}
+
+// expands shape descriptors into vertices, one work group per shape. the first invocation culls the
+// shape and reserves space in the indirect draw commands, then all of them fill a cell at a time
+static const char* sm_computeSource = "#version 430\n \
+					 layout(local_size_x = 64) in; \
+					 struct Shape { mat4 transform; vec4 colour; vec4 lineColour; vec4 ranges; vec4 bounds; uvec4 info; }; \
+					 struct Vertex { float x, y, z; uint colour; }; \
+					 struct Command { uint count; uint instanceCount; uint first; uint baseInstance; }; \
+					 layout(std430, binding = 0) readonly buffer Shapes { Shape shapes[]; }; \
+					 layout(std430, binding = 1) writeonly buffer Vertices { Vertex vertices[]; }; \
+					 layout(std430, binding = 2) buffer Commands { Command commands[3]; }; \
+					 uniform vec4 Frustum[6]; \
+					 uniform uint ShapeBase; \
+					 shared uint triBase; \
+					 shared uint lineBase; \
+					 shared bool visible; \
+					 vec3 point(Shape s, float u, float v) { \
+					 float a = mix(s.ranges.x, s.ranges.y, u); \
+					 float b = mix(s.ranges.z, s.ranges.w, v); \
+					 vec3 p = s.info.x == 0u ? vec3(-cos(b) * sin(a), sin(b), -cos(b) * cos(a)) : vec3(sin(a) * b, 0, cos(a) * b); \
+					 return (s.transform * vec4(p, 1)).xyz; } \
+					 void emit(uint index, vec3 p, uint colour) { vertices[index] = Vertex(p.x, p.y, p.z, colour); } \
+					 void main() { \
+					 Shape s = shapes[ShapeBase + gl_WorkGroupID.x]; \
+					 uint rows = s.info.y; uint cols = s.info.z; uint flags = s.info.w; \
+					 uint cells = rows * cols; \
+					 uint triVertices = (flags & 2u) != 0u ? 12u : 6u; \
+					 if (gl_LocalInvocationIndex == 0u) { \
+					 visible = true; \
+					 for (int i = 0; i < 6; ++i) \
+					 if (dot(Frustum[i].xyz, s.bounds.xyz) + Frustum[i].w < -s.bounds.w) visible = false; \
+					 if (visible) { \
+					 uint tris = (flags & 1u) != 0u ? cells * triVertices : 0u; \
+					 uint lines = (flags & 8u) != 0u ? cells * 8u : (flags & 16u) != 0u ? (rows + cols) * 4u : 0u; \
+					 uint region = (flags & 4u) != 0u ? 1u : 0u; \
+					 triBase = commands[region].first + atomicAdd(commands[region].count, tris); \
+					 lineBase = commands[2].first + atomicAdd(commands[2].count, lines); } } \
+					 barrier(); \
+					 if (!visible) return; \
+					 uint fill = packUnorm4x8(s.colour); \
+					 uint line = packUnorm4x8(s.lineColour); \
+					 for (uint cell = gl_LocalInvocationIndex; cell < cells; cell += 64u) { \
+					 float u0 = float(cell % cols) / float(cols); float u1 = float(cell % cols + 1u) / float(cols); \
+					 float v0 = float(cell / cols) / float(rows); float v1 = float(cell / cols + 1u) / float(rows); \
+					 vec3 p00 = point(s, u0, v0); vec3 p10 = point(s, u1, v0); \
+					 vec3 p01 = point(s, u0, v1); vec3 p11 = point(s, u1, v1); \
+					 if ((flags & 1u) != 0u) { \
+					 uint o = triBase + cell * triVertices; \
+					 emit(o, p11, fill); emit(o + 1u, p00, fill); emit(o + 2u, p10, fill); \
+					 emit(o + 3u, p11, fill); emit(o + 4u, p01, fill); emit(o + 5u, p00, fill); \
+					 if ((flags & 2u) != 0u) { \
+					 emit(o + 6u, p10, fill); emit(o + 7u, p00, fill); emit(o + 8u, p11, fill); \
+					 emit(o + 9u, p00, fill); emit(o + 10u, p01, fill); emit(o + 11u, p11, fill); } } \
+					 if ((flags & 8u) != 0u) { \
+					 uint o = lineBase + cell * 8u; \
+					 emit(o, p00, line); emit(o + 1u, p10, line); emit(o + 2u, p10, line); emit(o + 3u, p11, line); \
+					 emit(o + 4u, p11, line); emit(o + 5u, p01, line); emit(o + 6u, p01, line); emit(o + 7u, p00, line); } } \
+					 if ((flags & 16u) != 0u) { \
+					 for (uint i = gl_LocalInvocationIndex; i < rows + cols; i += 64u) { \
+					 uint o = lineBase + i * 4u; \
+					 if (i < cols) { \
+					 float u0 = float(i) / float(cols); float u1 = float(i + 1u) / float(cols); \
+					 emit(o, point(s, u0, 0.0), line); emit(o + 1u, point(s, u1, 0.0), line); \
+					 emit(o + 2u, point(s, u0, 1.0), line); emit(o + 3u, point(s, u1, 1.0), line); } \
+					 else { \
+					 float v0 = float(i - cols) / float(rows); float v1 = float(i - cols + 1u) / float(rows); \
+					 emit(o, point(s, 0.0, v0), line); emit(o + 1u, point(s, 0.0, v1), line); \
+					 emit(o + 2u, point(s, 1.0, v0), line); emit(o + 3u, point(s, 1.0, v1), line); } } } }";
 
 Gizmos::Gizmos(unsigned int maxLines, unsigned int maxTris,
 			   unsigned int max2DLines, unsigned int max2DTris)
-	: m_maxLines(maxLines),
-	m_lineCount(0),
-	m_lines(new GizmoLine[maxLines]),
-	m_maxTris(maxTris),
-	m_triCount(0),
-	m_tris(new GizmoTri[maxTris]),
-	m_transparentTriCount(0),
-	m_transparentTris(new GizmoTri[maxTris]),
-	m_max2DLines(max2DLines),
-	m_2DlineCount(0),
-	m_2Dlines(new GizmoLine[max2DLines]),
-	m_max2DTris(max2DTris),
-	m_2DtriCount(0),
-	m_2Dtris(new GizmoTri[max2DTris]) {
+	: m_font(nullptr),
+	m_nextGroup(1),
+	m_hasCamera(false),
+	m_pointSize(1),
+	m_weightedTransparency(false),
+	m_weightedFBO(0),
+	m_weightedWidth(0),
+	m_weightedHeight(0),
+	m_computeShader(0),
+	m_computeTessellation(false),
+	m_startTime(std::chrono::steady_clock::now()),
+	m_channelMask(~0ull) {
 
 	// create shaders
 	const char* vsSource = "#version 150\n \
+					 in vec3 Position; \
+					 in vec4 Colour; \
+					 out vec4 vColour; \
+					 uniform mat4 ProjectionView; \
+					 void main() { vColour = Colour; gl_Position = ProjectionView * vec4(Position, 1); }";
+
+	// unit meshes tag vertices in w: 1 scales a ring's inner edge by Params.x,
+	// 2 and 3 move a capsule's top and bottom halves by Params.y
+	const char* instanceSource = "#version 150\n \
 					 in vec4 Position; \
 					 in vec4 Colour; \
+					 in mat4 Transform; \
+					 in vec2 Params; \
 					 out vec4 vColour; \
 					 uniform mat4 ProjectionView; \
-					 void main() { vColour = Colour; gl_Position = ProjectionView * Position; }";
+					 void main() { vec3 p = Position.xyz; \
+					 if (Position.w == 1) p.xz *= Params.x; \
+					 else if (Position.w == 2) p.y += Params.y; \
+					 else if (Position.w == 3) p.y -= Params.y; \
+					 vColour = Colour; gl_Position = ProjectionView * Transform * vec4(p, 1); }";
+
+	m_shader = createProgram(vsSource, sm_fragmentSource);
+	m_instanceShader = createProgram(instanceSource, sm_fragmentSource);
+	m_weightedShader = createProgram(vsSource, sm_weightedFragmentSource);
+	m_weightedInstanceShader = createProgram(instanceSource, sm_weightedFragmentSource);
+
+	// grids are a full-screen triangle, with each pixel's ray hitting the grid's plane
+	const char* gridVSSource = "#version 150\n \
+					 out vec2 vPosition; \
+					 void main() { vPosition = vec2((gl_VertexID & 1) * 4 - 1, (gl_VertexID & 2) * 2 - 1); \
+					 gl_Position = vec4(vPosition, 0, 1); }";
+
+	// line widths come from the screen-space rate of change, so lines stay a pixel wide and
+	// fade out where they'd be closer together than the pixels
+	const char* gridFSSource = "#version 150\n \
+					 in vec2 vPosition; \
+					 out vec4 FragColor; \
+					 uniform mat4 ProjectionView; \
+					 uniform mat4 InverseProjectionView; \
+					 uniform vec3 Center; \
+					 uniform vec3 AxisU; \
+					 uniform vec3 AxisV; \
+					 uniform float Spacing; \
+					 uniform float Extent; \
+					 uniform vec4 Colour; \
+					 uniform vec4 AxisColour; \
+					 void main() { \
+					 vec4 n = InverseProjectionView * vec4(vPosition, -1, 1); \
+					 vec4 f = InverseProjectionView * vec4(vPosition, 1, 1); \
+					 vec3 origin = n.xyz / n.w; \
+					 vec3 direction = f.xyz / f.w - origin; \
+					 vec3 normal = cross(AxisU, AxisV); \
+					 float denom = dot(direction, normal); \
+					 float t = abs(denom) > 0.000001 ? dot(Center - origin, normal) / denom : -1.0; \
+					 vec3 p = origin + direction * t; \
+					 vec2 cell = vec2(dot(p - Center, AxisU), dot(p - Center, AxisV)) / Spacing; \
+					 vec2 width = fwidth(cell); \
+					 if (t < 0.0 || t > 1.0) discard; \
+					 if (Extent > 0.0 && any(greaterThan(abs(cell), vec2(Extent / Spacing) + width * 0.5))) discard; \
+					 vec2 line = abs(fract(cell - 0.5) - 0.5) / width; \
+					 vec2 axis = abs(cell) / width; \
+					 float lines = 1.0 - min(min(line.x, line.y), 1.0); \
+					 float axes = 1.0 - min(min(axis.x, axis.y), 1.0); \
+					 float fade = 1.0 - smoothstep(0.25, 0.5, max(width.x, width.y)); \
+					 if (Extent <= 0.0) fade *= 1.0 - smoothstep(50.0, 100.0, length(p - origin) / Spacing); \
+					 vec4 colour = mix(Colour, AxisColour, axes); \
+					 colour.a *= max(lines * fade, axes); \
+					 if (colour.a <= 0.0) discard; \
+					 vec4 clip = ProjectionView * vec4(p, 1); \
+					 gl_FragDepth = clip.z / clip.w * 0.5 + 0.5; \
+					 FragColor = colour; }";
+
+	m_gridShader = createProgram(gridVSSource, gridFSSource);
+
+	// the resolve is a full-screen triangle too
+	m_resolveShader = createProgram(gridVSSource, sm_resolveFragmentSource);
+	glUseProgram(m_resolveShader);
+	glUniform1i(glGetUniformLocation(m_resolveShader, "Accumulation"), 0);
+	glUniform1i(glGetUniformLocation(m_resolveShader, "Revealage"), 1);
+	glUseProgram(0);
+
+	// expired primitives are moved outside the clip volume, so they're discarded before rasterising
+	const char* timedSource = "#version 150\n \
+					 in vec3 Position; \
+					 in vec4 Colour; \
+					 in float Expiry; \
+					 out vec4 vColour; \
+					 uniform mat4 ProjectionView; \
+					 uniform float Time; \
+					 void main() { vColour = Colour; \
+					 gl_Position = Expiry > Time ? ProjectionView * vec4(Position, 1) : vec4(2, 2, 2, 1); }";
+
+	m_timedShader = createProgram(timedSource, sm_fragmentSource);
 
-	const char* fsSource = "#version 150\n \
+	// segments are expanded to screen-space quads, 6 vertices for the body and 3 for the arrow head,
+	// with distances along them in pixels for dashes. ends behind the camera are pulled onto its near side
+	const char* segmentVSSource = "#version 150\n \
+					 in vec3 Start; \
+					 in vec3 End; \
+					 in vec4 Colour; \
+					 in vec3 Style; \
+					 out vec4 vColour; \
+					 out float vDistance; \
+					 flat out float vDash; \
+					 uniform mat4 ProjectionView; \
+					 uniform vec2 ViewportSize; \
+					 void main() { \
+					 vec4 a = ProjectionView * vec4(Start, 1); \
+					 vec4 b = ProjectionView * vec4(End, 1); \
+					 if (a.w < 0.0001 && b.w < 0.0001) { gl_Position = vec4(2, 2, 2, 1); return; } \
+					 if (a.w < 0.0001) a = mix(a, b, (0.0001 - a.w) / (b.w - a.w)); \
+					 if (b.w < 0.0001) b = mix(b, a, (0.0001 - b.w) / (a.w - b.w)); \
+					 vec2 halfSize = ViewportSize * 0.5; \
+					 vec2 sa = a.xy / a.w * halfSize; \
+					 vec2 sb = b.xy / b.w * halfSize; \
+					 float len = length(sb - sa); \
+					 vec2 dir = len > 0.0 ? (sb - sa) / len : vec2(1, 0); \
+					 vec2 side = vec2(-dir.y, dir.x); \
+					 float head = min(Style.z, len); \
+					 float bodyEnd = len - head; \
+					 float along; float across; \
+					 const int corners[6] = int[6](0, 1, 2, 2, 1, 3); \
+					 if (gl_VertexID < 6) { \
+					 int corner = corners[gl_VertexID]; \
+					 along = (corner & 1) == 1 ? bodyEnd : 0.0; \
+					 across = ((corner & 2) == 2 ? 0.5 : -0.5) * Style.x; } \
+					 else { \
+					 along = gl_VertexID == 8 ? len : bodyEnd; \
+					 across = gl_VertexID == 6 ? -head * 0.5 : gl_VertexID == 7 ? head * 0.5 : 0.0; } \
+					 float t = len > 0.0 ? along / len : 0.0; \
+					 vec4 clip = mix(a, b, t); \
+					 vec2 p = sa + dir * along + side * across; \
+					 gl_Position = vec4(p / halfSize * clip.w, clip.z, clip.w); \
+					 vColour = Colour; vDistance = along; vDash = Style.y; }";
+
+	const char* segmentFSSource = "#version 150\n \
 					 in vec4 vColour; \
-                     out vec4 FragColor; \
-					 void main()	{ FragColor = vColour; }";
-    
-    
-	unsigned int vs = glCreateShader(GL_VERTEX_SHADER);
-	unsigned int fs = glCreateShader(GL_FRAGMENT_SHADER);
-
-	glShaderSource(vs, 1, (const char**)&vsSource, 0);
-	glCompileShader(vs);
-
-	glShaderSource(fs, 1, (const char**)&fsSource, 0);
-	glCompileShader(fs);
-
-	m_shader = glCreateProgram();
-	glAttachShader(m_shader, vs);
-	glAttachShader(m_shader, fs);
-	glBindAttribLocation(m_shader, 0, "Position");
-	glBindAttribLocation(m_shader, 1, "Colour");
-	glLinkProgram(m_shader);
-    
-	int success = GL_FALSE;
-    glGetProgramiv(m_shader, GL_LINK_STATUS, &success);
-	if (success == GL_FALSE) {
-		int infoLogLength = 0;
-		glGetProgramiv(m_shader, GL_INFO_LOG_LENGTH, &infoLogLength);
-		char* infoLog = new char[infoLogLength + 1];
-        
-		glGetProgramInfoLog(m_shader, infoLogLength, 0, infoLog);
-		printf("Error: Failed to link Gizmo shader program!\n%s\n", infoLog);
-		delete[] infoLog;
-	}
-
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-    
-    // create VBOs
-	glGenBuffers( 1, &m_lineVBO );
-	glBindBuffer(GL_ARRAY_BUFFER, m_lineVBO);
-	glBufferData(GL_ARRAY_BUFFER, m_maxLines * sizeof(GizmoLine), m_lines, GL_DYNAMIC_DRAW);
-
-	glGenBuffers( 1, &m_triVBO );
-	glBindBuffer(GL_ARRAY_BUFFER, m_triVBO);
-	glBufferData(GL_ARRAY_BUFFER, m_maxTris * sizeof(GizmoTri), m_tris, GL_DYNAMIC_DRAW);
-
-	glGenBuffers( 1, &m_transparentTriVBO );
-	glBindBuffer(GL_ARRAY_BUFFER, m_transparentTriVBO);
-	glBufferData(GL_ARRAY_BUFFER, m_maxTris * sizeof(GizmoTri), m_transparentTris, GL_DYNAMIC_DRAW);
-
-	glGenBuffers( 1, &m_2DlineVBO );
-	glBindBuffer(GL_ARRAY_BUFFER, m_2DlineVBO);
-	glBufferData(GL_ARRAY_BUFFER, m_max2DLines * sizeof(GizmoLine), m_2Dlines, GL_DYNAMIC_DRAW);
-
-	glGenBuffers( 1, &m_2DtriVBO );
-	glBindBuffer(GL_ARRAY_BUFFER, m_2DtriVBO);
-	glBufferData(GL_ARRAY_BUFFER, m_max2DTris * sizeof(GizmoTri), m_2Dtris, GL_DYNAMIC_DRAW);
-
-	glGenVertexArrays(1, &m_lineVAO);
-	glBindVertexArray(m_lineVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_lineVBO);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), 0);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), (void*)16);
+					 in float vDistance; \
+					 flat in float vDash; \
+					 out vec4 FragColor; \
+					 void main() { if (vDash > 0.0 && mod(vDistance, vDash * 2.0) > vDash) discard; \
+					 FragColor = vColour; }";
+
+	m_segmentShader = createProgram(segmentVSSource, segmentFSSource);
+
+	// the per-instance attributes are pointed at a layer's buffer by drawSegments()
+	glGenVertexArrays(1, &m_segmentVAO);
+	glBindVertexArray(m_segmentVAO);
+	for (unsigned int i = 1; i <= 4; ++i) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+	glBindVertexArray(0);
 
-	glGenVertexArrays(1, &m_triVAO);
-	glBindVertexArray(m_triVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_triVBO);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), 0);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), (void*)16);
+	// each pair of vertices is a line between two points on the curve. the control points' spread on
+	// screen gives the segments needed to stay within the tolerance, and vertices past them are
+	// moved outside the clip volume. bezier curves stay bezier curves through the projection, so
+	// they're evaluated in clip space
+	const char* curveVSSource = "#version 150\n \
+					 in vec3 Control0; \
+					 in vec3 Control1; \
+					 in vec3 Control2; \
+					 in vec3 Control3; \
+					 in vec4 Colour; \
+					 in float Segments; \
+					 out vec4 vColour; \
+					 uniform mat4 ProjectionView; \
+					 uniform vec2 ViewportSize; \
+					 uniform float Tolerance; \
+					 void main() { \
+					 vec4 c0 = ProjectionView * vec4(Control0, 1); \
+					 vec4 c1 = ProjectionView * vec4(Control1, 1); \
+					 vec4 c2 = ProjectionView * vec4(Control2, 1); \
+					 vec4 c3 = ProjectionView * vec4(Control3, 1); \
+					 float segments = Segments; \
+					 if (min(min(c0.w, c1.w), min(c2.w, c3.w)) > 0.0001) { \
+					 vec2 halfSize = ViewportSize * 0.5; \
+					 vec2 s0 = c0.xy / c0.w * halfSize; \
+					 vec2 s1 = c1.xy / c1.w * halfSize; \
+					 vec2 s2 = c2.xy / c2.w * halfSize; \
+					 vec2 s3 = c3.xy / c3.w * halfSize; \
+					 float bend = max(length(s0 - 2.0 * s1 + s2), length(s1 - 2.0 * s2 + s3)); \
+					 segments = clamp(ceil(sqrt(0.75 * bend / Tolerance)), 1.0, Segments); } \
+					 int segment = gl_VertexID / 2; \
+					 if (float(segment) >= segments) { gl_Position = vec4(2, 2, 2, 1); return; } \
+					 float t = float(segment + gl_VertexID % 2) / segments; \
+					 float s = 1.0 - t; \
+					 gl_Position = c0 * (s * s * s) + c1 * (3.0 * s * s * t) + c2 * (3.0 * s * t * t) + c3 * (t * t * t); \
+					 vColour = Colour; }";
+
+	m_curveShader = createProgram(curveVSSource, sm_fragmentSource);
+
+	// the per-instance attributes are pointed at a layer's buffer by drawCurves()
+	glGenVertexArrays(1, &m_curveVAO);
+	glBindVertexArray(m_curveVAO);
+	for (unsigned int i = 1; i <= 6; ++i) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+	glBindVertexArray(0);
 
-	glGenVertexArrays(1, &m_transparentTriVAO);
-	glBindVertexArray(m_transparentTriVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_transparentTriVBO);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), 0);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), (void*)16);
+	// glyphs are quads offset in pixels from their label's projected position
+	const char* textVSSource = "#version 150\n \
+					 in vec3 Position; \
+					 in vec4 Colour; \
+					 in vec4 Offset; \
+					 in vec4 TexCoords; \
+					 out vec4 vColour; \
+					 out vec2 vTexCoord; \
+					 uniform mat4 ProjectionView; \
+					 uniform vec2 ViewportSize; \
+					 void main() { \
+					 vec4 clip = ProjectionView * vec4(Position, 1); \
+					 if (clip.w < 0.0001) { gl_Position = vec4(2, 2, 2, 1); return; } \
+					 const int corners[6] = int[6](0, 1, 2, 2, 1, 3); \
+					 int corner = corners[gl_VertexID]; \
+					 vec2 offset = vec2((corner & 1) == 1 ? Offset.z : Offset.x, (corner & 2) == 2 ? Offset.w : Offset.y); \
+					 vTexCoord = vec2((corner & 1) == 1 ? TexCoords.z : TexCoords.x, (corner & 2) == 2 ? TexCoords.w : TexCoords.y); \
+					 gl_Position = vec4(clip.xy + offset / (ViewportSize * 0.5) * clip.w, clip.z, clip.w); \
+					 vColour = Colour; }";
+
+	const char* textFSSource = "#version 150\n \
+					 in vec4 vColour; \
+					 in vec2 vTexCoord; \
+					 out vec4 FragColor; \
+					 uniform sampler2D Glyphs; \
+					 void main() { FragColor = vec4(vColour.rgb, vColour.a * texture(Glyphs, vTexCoord).r); }";
+
+	m_textShader = createProgram(textVSSource, textFSSource);
+
+	// the per-instance attributes are pointed at a layer's buffer by drawText()
+	glGenVertexArrays(1, &m_textVAO);
+	glBindVertexArray(m_textVAO);
+	for (unsigned int i = 0; i <= 3; ++i) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+	glBindVertexArray(0);
 
-	glGenVertexArrays(1, &m_2DlineVAO);
-	glBindVertexArray(m_2DlineVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_2DlineVBO);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), 0);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), (void*)16);
+	// compute shaders need OpenGL 4.3
+	if (ogl_IsVersionGEQ(4, 3))
+		m_computeShader = createComputeShaderProgram(sm_computeSource, "Gizmo compute");
 
-	glGenVertexArrays(1, &m_2DtriVAO);
-	glBindVertexArray(m_2DtriVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_2DtriVBO);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), 0);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), (void*)16);
+	initTimedRing(m_timedLines, 2);
+	initTimedRing(m_timedTris, 3);
 
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// the triangle has no attributes, but core profiles still need a vao bound
+	glGenVertexArrays(1, &m_gridVAO);
+
+	// the max values are only a starting size, streams grow as needed
+	initLayer(m_frameLayer, maxLines, maxTris, max2DLines, max2DTris);
+
+	m_channelNames.push_back("Default");
+
+	// the creating thread adds straight to the frame layer
+	sm_generation++;
+	sm_threadLayers.generation = sm_generation;
+	sm_threadLayers.frame = &m_frameLayer;
+	sm_threadLayers.current = &m_frameLayer;
 }
 
 Gizmos::~Gizmos() {
-	delete[] m_lines;
-	delete[] m_tris;
-	delete[] m_transparentTris;
-	glDeleteBuffers( 1, &m_lineVBO );
-	glDeleteBuffers( 1, &m_triVBO );
-	glDeleteBuffers( 1, &m_transparentTriVBO );
-	glDeleteVertexArrays( 1, &m_lineVAO );
-	glDeleteVertexArrays( 1, &m_triVAO );
-	glDeleteVertexArrays( 1, &m_transparentTriVAO );
-	delete[] m_2Dlines;
-	delete[] m_2Dtris;
-	glDeleteBuffers( 1, &m_2DlineVBO );
-	glDeleteBuffers( 1, &m_2DtriVBO );
-	glDeleteVertexArrays( 1, &m_2DlineVAO );
-	glDeleteVertexArrays( 1, &m_2DtriVAO );
+	for (auto& group : m_groups) {
+		destroyLayer(*group.second);
+		delete group.second;
+	}
+	for (auto layer : m_threadLayers) {
+		destroyLayer(*layer);
+		delete layer;
+	}
+	destroyLayer(m_frameLayer);
+	for (auto block : m_freeBlocks)
+		delete[] block;
+	for (auto& mesh : m_unitMeshes) {
+		glDeleteBuffers(1, &mesh.second->vbo);
+		glDeleteBuffers(1, &mesh.second->ibo);
+		glDeleteVertexArrays(1, &mesh.second->vao);
+		delete mesh.second;
+	}
+	destroyTimedRing(m_timedLines);
+	destroyTimedRing(m_timedTris);
+	glDeleteProgram(m_timedShader);
+	if (m_computeShader != 0)
+		glDeleteProgram(m_computeShader);
+	glDeleteVertexArrays(1, &m_textVAO);
+	glDeleteProgram(m_textShader);
+	glDeleteVertexArrays(1, &m_curveVAO);
+	glDeleteProgram(m_curveShader);
+	glDeleteVertexArrays(1, &m_segmentVAO);
+	glDeleteProgram(m_segmentShader);
+	glDeleteVertexArrays(1, &m_gridVAO);
+	glDeleteProgram(m_gridShader);
+	if (m_weightedFBO != 0) {
+		glDeleteFramebuffers(1, &m_weightedFBO);
+		glDeleteTextures(2, m_weightedTargets);
+		glDeleteRenderbuffers(1, &m_weightedDepth);
+	}
+	glDeleteProgram(m_resolveShader);
+	glDeleteProgram(m_weightedInstanceShader);
+	glDeleteProgram(m_weightedShader);
+	glDeleteProgram(m_instanceShader);
 	glDeleteProgram(m_shader);
 }
 
+void Gizmos::initStream(GizmoStream& stream, unsigned int elementSize, unsigned int reserve) {
+
+	stream.elementSize = elementSize;
+	stream.elementsPerBlock = BLOCK_SIZE / elementSize;
+	stream.count = 0;
+	stream.highWaterMark = 0;
+	stream.capacity = reserve;
+
+	// GL objects are made when first uploaded, as streams may be created on any thread
+	stream.buffer = 0;
+
+	// fill the arena with enough blocks for the reserve
+	unsigned int blockCount = (reserve + stream.elementsPerBlock - 1) / stream.elementsPerBlock;
+	if (blockCount > 0) {
+		std::lock_guard<std::mutex> lock(m_arenaMutex);
+		for (unsigned int i = 0; i < blockCount; ++i)
+			m_freeBlocks.push_back(new char[BLOCK_SIZE]);
+	}
+}
+
+void Gizmos::destroyStream(GizmoStream& stream) {
+	for (auto block : stream.blocks)
+		delete[] block;
+	stream.blocks.clear();
+	if (stream.buffer != 0)
+		glDeleteBuffers(1, &stream.buffer);
+}
+
+void Gizmos::resetStream(GizmoStream& stream) {
+	// hand the blocks back to the arena
+	if (stream.blocks.empty() == false) {
+		std::lock_guard<std::mutex> lock(m_arenaMutex);
+		m_freeBlocks.insert(m_freeBlocks.end(), stream.blocks.begin(), stream.blocks.end());
+	}
+	stream.blocks.clear();
+	stream.count = 0;
+}
+
+void* Gizmos::allocate(GizmoStream& stream) {
+	unsigned int allocated = 0;
+	return allocate(stream, 1, allocated);
+}
+
+void* Gizmos::allocate(GizmoStream& stream, unsigned int count, unsigned int& allocated) {
+
+	unsigned int block = stream.count / stream.elementsPerBlock;
+	unsigned int index = stream.count % stream.elementsPerBlock;
+
+	// streams belong to one thread, so only the arena needs a lock
+	if (block == stream.blocks.size()) {
+		std::lock_guard<std::mutex> lock(m_arenaMutex);
+		if (m_freeBlocks.empty()) {
+			stream.blocks.push_back(new char[BLOCK_SIZE]);
+		}
+		else {
+			stream.blocks.push_back(m_freeBlocks.back());
+			m_freeBlocks.pop_back();
+		}
+	}
+
+	// as many as fit in the block
+	allocated = stream.elementsPerBlock - index;
+	if (allocated > count)
+		allocated = count;
+
+	stream.count += allocated;
+	if (stream.count > stream.highWaterMark)
+		stream.highWaterMark = stream.count;
+
+	return stream.blocks[block] + index * stream.elementSize;
+}
+
+void Gizmos::upload(GizmoStream& stream, unsigned int target, unsigned int usage) {
+
+	glBindBuffer(target, stream.buffer);
+
+	// retained data never changes so fits exactly, otherwise grow if needed
+	// or orphan the old storage so we don't wait on the last draw using it
+	if (usage == GL_STATIC_DRAW) {
+		stream.capacity = stream.count;
+	}
+	else if (stream.count > stream.capacity) {
+		if (stream.capacity == 0)
+			stream.capacity = stream.elementsPerBlock;
+		while (stream.capacity < stream.count)
+			stream.capacity *= 2;
+	}
+	glBufferData(target, stream.capacity * stream.elementSize, nullptr, usage);
+
+	// only the last block is partly filled, so the elements upload contiguously
+	unsigned int offset = 0;
+	unsigned int remaining = stream.count;
+	for (auto block : stream.blocks) {
+		unsigned int count = remaining < stream.elementsPerBlock ? remaining : stream.elementsPerBlock;
+		glBufferSubData(target, offset, count * stream.elementSize, block);
+
+		offset += count * stream.elementSize;
+		remaining -= count;
+		if (remaining == 0)
+			break;
+	}
+}
+
+void Gizmos::initBuffer(GizmoBuffer& buffer, unsigned int vertexReserve, unsigned int indexReserve) {
+	initStream(buffer.vertices, sizeof(GizmoVertex), vertexReserve);
+	initStream(buffer.indices, sizeof(unsigned int), indexReserve);
+	buffer.indexCount = 0;
+	buffer.vao = 0;
+}
+
+void Gizmos::destroyBuffer(GizmoBuffer& buffer) {
+	destroyStream(buffer.vertices);
+	destroyStream(buffer.indices);
+	if (buffer.vao != 0)
+		glDeleteVertexArrays(1, &buffer.vao);
+}
+
+void Gizmos::resetBuffer(GizmoBuffer& buffer) {
+	resetStream(buffer.vertices);
+	resetStream(buffer.indices);
+}
+
+unsigned int Gizmos::addVertex(GizmoBuffer& buffer, float x, float y, float z, const glm::vec4& colour) {
+	unsigned int index = buffer.vertices.count;
+	setVertex(*(GizmoVertex*)allocate(buffer.vertices), x, y, z, colour);
+	return index;
+}
+
+unsigned int Gizmos::addVertices(GizmoBuffer& buffer, const glm::vec3* positions, unsigned int count, const glm::vec4& colour) {
+	unsigned int base = buffer.vertices.count;
+	for (unsigned int i = 0; i < count; ++i)
+		setVertex(*(GizmoVertex*)allocate(buffer.vertices), positions[i].x, positions[i].y, positions[i].z, colour);
+	return base;
+}
+
+void Gizmos::addIndices(GizmoBuffer& buffer, const unsigned int* indices, unsigned int count, unsigned int base) {
+	for (unsigned int i = 0; i < count; ++i)
+		*(unsigned int*)allocate(buffer.indices) = base + indices[i];
+}
+
+void Gizmos::copyVertices(GizmoStream& stream, const glm::vec3* positions, unsigned int positionStride,
+						  const glm::vec4* colours, unsigned int colourStride, const glm::vec4& colour, unsigned int count) {
+
+	const char* position = (const char*)positions;
+	const char* vertexColour = (const char*)colours;
+	if (positionStride == 0)
+		positionStride = sizeof(glm::vec3);
+	if (colourStride == 0)
+		colourStride = sizeof(glm::vec4);
+
+	// the colour is only converted once when it's shared
+	GizmoVertex solid;
+	setVertex(solid, 0, 0, 0, colour);
+
+	// a block at a time, rather than allocating each vertex
+	while (count > 0) {
+		unsigned int allocated = 0;
+		GizmoVertex* vertices = (GizmoVertex*)allocate(stream, count, allocated);
+
+		for (unsigned int i = 0; i < allocated; ++i) {
+			const float* p = (const float*)position;
+			if (vertexColour != nullptr) {
+				setVertex(vertices[i], p[0], p[1], p[2], *(const glm::vec4*)vertexColour);
+				vertexColour += colourStride;
+			}
+			else {
+				vertices[i] = solid;
+				vertices[i].x = p[0];
+				vertices[i].y = p[1];
+				vertices[i].z = p[2];
+			}
+			position += positionStride;
+		}
+
+		count -= allocated;
+	}
+}
+
+void Gizmos::copyIndices(GizmoStream& stream, unsigned int base, unsigned int count) {
+	while (count > 0) {
+		unsigned int allocated = 0;
+		unsigned int* indices = (unsigned int*)allocate(stream, count, allocated);
+
+		for (unsigned int i = 0; i < allocated; ++i)
+			indices[i] = base++;
+
+		count -= allocated;
+	}
+}
+
+void Gizmos::uploadBuffer(GizmoBuffer& buffer, unsigned int usage) {
+	buffer.indexCount = buffer.indices.count;
+	if (buffer.indexCount == 0)
+		return;
+
+	if (buffer.vao == 0) {
+		glGenBuffers(1, &buffer.vertices.buffer);
+		glGenBuffers(1, &buffer.indices.buffer);
+
+		glGenVertexArrays(1, &buffer.vao);
+		glBindVertexArray(buffer.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer.vertices.buffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.indices.buffer);
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), 0);
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GizmoVertex), (void*)12);
+	}
+
+	// the element buffer binding belongs to the vao
+	glBindVertexArray(buffer.vao);
+	upload(buffer.vertices, GL_ARRAY_BUFFER, usage);
+	upload(buffer.indices, GL_ELEMENT_ARRAY_BUFFER, usage);
+}
+
+void Gizmos::drawBuffer(const GizmoBuffer& buffer, unsigned int mode) {
+	if (buffer.indexCount > 0) {
+		glBindVertexArray(buffer.vao);
+		glDrawElements(mode, buffer.indexCount, GL_UNSIGNED_INT, 0);
+	}
+}
+
+void Gizmos::initLayer(Layer& layer, unsigned int lineReserve, unsigned int triReserve,
+					   unsigned int line2DReserve, unsigned int tri2DReserve) {
+
+	initBuffer(layer.lines, lineReserve * 2, lineReserve * 2);
+	initBuffer(layer.tris, triReserve * 3, triReserve * 3);
+	initBuffer(layer.transparentTris, triReserve * 3, triReserve * 3);
+	initBuffer(layer.lines2D, line2DReserve * 2, line2DReserve * 2);
+	initBuffer(layer.tris2D, tri2DReserve * 3, tri2DReserve * 3);
+
+	initStream(layer.points, sizeof(GizmoVertex), 0);
+	layer.pointCount = 0;
+	layer.pointVAO = 0;
+
+	layer.segmentCount = 0;
+	layer.segmentCapacity = 0;
+	layer.segmentVBO = 0;
+
+	layer.curveCount = 0;
+	layer.curveCapacity = 0;
+	layer.curveSegments = 0;
+	layer.curveVBO = 0;
+
+	layer.glyphCount = 0;
+	layer.overlayGlyphCount = 0;
+	layer.glyphCapacity = 0;
+	layer.glyphVBO = 0;
+
+	ComputeBatch& batch = layer.compute;
+	batch.shapeCount = 0;
+	batch.shapeCapacity = 0;
+	batch.vertexCapacity = 0;
+	for (unsigned int i = 0; i < 3; ++i) {
+		batch.regionSize[i] = 0;
+		batch.regionFirst[i] = 0;
+	}
+	batch.shapeBuffer = 0;
+	batch.vertexBuffer = 0;
+	batch.commandBuffer = 0;
+	batch.vao = 0;
+
+	layer.instanceCount = 0;
+	layer.instanceHighWaterMark = 0;
+	layer.instanceCapacity = 0;
+	layer.instanceVBO = 0;
+
+	layer.building = false;
+	layer.pendingUpload = false;
+	layer.abandoned = false;
+	layer.visible = true;
+	memcpy(layer.transform, glm::value_ptr(glm::mat4(1)), sizeof(float) * 16);
+}
+
+void Gizmos::destroyLayer(Layer& layer) {
+	destroyBuffer(layer.lines);
+	destroyBuffer(layer.tris);
+	destroyBuffer(layer.transparentTris);
+	destroyBuffer(layer.lines2D);
+	destroyBuffer(layer.tris2D);
+	destroyStream(layer.points);
+	if (layer.pointVAO != 0)
+		glDeleteVertexArrays(1, &layer.pointVAO);
+	if (layer.segmentVBO != 0)
+		glDeleteBuffers(1, &layer.segmentVBO);
+	if (layer.curveVBO != 0)
+		glDeleteBuffers(1, &layer.curveVBO);
+	if (layer.glyphVBO != 0)
+		glDeleteBuffers(1, &layer.glyphVBO);
+	if (layer.compute.vao != 0) {
+		glDeleteBuffers(1, &layer.compute.shapeBuffer);
+		glDeleteBuffers(1, &layer.compute.vertexBuffer);
+		glDeleteBuffers(1, &layer.compute.commandBuffer);
+		glDeleteVertexArrays(1, &layer.compute.vao);
+	}
+	if (layer.instanceVBO != 0)
+		glDeleteBuffers(1, &layer.instanceVBO);
+}
+
+void Gizmos::resetLayer(Layer& layer) {
+	resetBuffer(layer.lines);
+	resetBuffer(layer.tris);
+	resetBuffer(layer.transparentTris);
+	resetBuffer(layer.lines2D);
+	resetBuffer(layer.tris2D);
+	resetStream(layer.points);
+	layer.segments.clear();
+	layer.curves.clear();
+	layer.curveSegments = 0;
+	layer.glyphs.clear();
+	layer.overlayGlyphs.clear();
+	layer.grids.clear();
+
+	layer.compute.shapes.clear();
+	for (unsigned int i = 0; i < 3; ++i)
+		layer.compute.regionSize[i] = 0;
+
+	for (auto& mesh : layer.instances) {
+		mesh.second.lines.clear();
+		mesh.second.tris.clear();
+		mesh.second.transparentTris.clear();
+	}
+	layer.instanceCount = 0;
+}
+
+void Gizmos::uploadLayer(Layer& layer, unsigned int usage) {
+
+	uploadBuffer(layer.lines, usage);
+	uploadBuffer(layer.tris, usage);
+	uploadBuffer(layer.transparentTris, usage);
+
+	layer.pointCount = layer.points.count;
+	if (layer.pointCount > 0) {
+		if (layer.pointVAO == 0) {
+			glGenBuffers(1, &layer.points.buffer);
+
+			glGenVertexArrays(1, &layer.pointVAO);
+			glBindVertexArray(layer.pointVAO);
+			glBindBuffer(GL_ARRAY_BUFFER, layer.points.buffer);
+			glEnableVertexAttribArray(0);
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), 0);
+			glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GizmoVertex), (void*)12);
+		}
+		upload(layer.points, GL_ARRAY_BUFFER, usage);
+	}
+
+	layer.segmentCount = (unsigned int)layer.segments.size();
+	if (layer.segmentCount > 0) {
+		if (layer.segmentVBO == 0)
+			glGenBuffers(1, &layer.segmentVBO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, layer.segmentVBO);
+
+		// grow if needed, otherwise orphan
+		if (layer.segmentCount > layer.segmentCapacity) {
+			if (layer.segmentCapacity == 0)
+				layer.segmentCapacity = 256;
+			while (layer.segmentCapacity < layer.segmentCount)
+				layer.segmentCapacity *= 2;
+		}
+		glBufferData(GL_ARRAY_BUFFER, layer.segmentCapacity * sizeof(GizmoSegment), nullptr, usage);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, layer.segmentCount * sizeof(GizmoSegment), layer.segments.data());
+	}
+
+	layer.curveCount = (unsigned int)layer.curves.size();
+	if (layer.curveCount > 0) {
+		if (layer.curveVBO == 0)
+			glGenBuffers(1, &layer.curveVBO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, layer.curveVBO);
+
+		// grow if needed, otherwise orphan
+		if (layer.curveCount > layer.curveCapacity) {
+			if (layer.curveCapacity == 0)
+				layer.curveCapacity = 256;
+			while (layer.curveCapacity < layer.curveCount)
+				layer.curveCapacity *= 2;
+		}
+		glBufferData(GL_ARRAY_BUFFER, layer.curveCapacity * sizeof(GizmoCurve), nullptr, usage);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, layer.curveCount * sizeof(GizmoCurve), layer.curves.data());
+	}
+
+	layer.glyphCount = (unsigned int)layer.glyphs.size();
+	layer.overlayGlyphCount = (unsigned int)layer.overlayGlyphs.size();
+	unsigned int glyphTotal = layer.glyphCount + layer.overlayGlyphCount;
+	if (glyphTotal > 0) {
+		if (layer.glyphVBO == 0)
+			glGenBuffers(1, &layer.glyphVBO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, layer.glyphVBO);
+
+		// grow if needed, otherwise orphan
+		if (glyphTotal > layer.glyphCapacity) {
+			if (layer.glyphCapacity == 0)
+				layer.glyphCapacity = 1024;
+			while (layer.glyphCapacity < glyphTotal)
+				layer.glyphCapacity *= 2;
+		}
+		glBufferData(GL_ARRAY_BUFFER, layer.glyphCapacity * sizeof(GizmoGlyph), nullptr, usage);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, layer.glyphCount * sizeof(GizmoGlyph), layer.glyphs.data());
+		glBufferSubData(GL_ARRAY_BUFFER, layer.glyphCount * sizeof(GizmoGlyph),
+						layer.overlayGlyphCount * sizeof(GizmoGlyph), layer.overlayGlyphs.data());
+	}
+
+	uploadComputeBatch(layer.compute, usage);
+
+	// every mesh's instances go into the one buffer
+	unsigned int total = 0;
+	for (auto& mesh : layer.instances) {
+		MeshInstances& m = mesh.second;
+		m.lineBase = total;
+		m.lineCount = (unsigned int)m.lines.size();
+		m.triBase = m.lineBase + m.lineCount;
+		m.triCount = (unsigned int)m.tris.size();
+		m.transparentTriBase = m.triBase + m.triCount;
+		m.transparentTriCount = (unsigned int)m.transparentTris.size();
+		total = m.transparentTriBase + m.transparentTriCount;
+	}
+
+	if (total == 0)
+		return;
+
+	if (layer.instanceVBO == 0)
+		glGenBuffers(1, &layer.instanceVBO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, layer.instanceVBO);
+
+	// grow if needed, otherwise orphan
+	if (total > layer.instanceCapacity) {
+		if (layer.instanceCapacity == 0)
+			layer.instanceCapacity = 256;
+		while (layer.instanceCapacity < total)
+			layer.instanceCapacity *= 2;
+	}
+	glBufferData(GL_ARRAY_BUFFER, layer.instanceCapacity * sizeof(GizmoInstance), nullptr, usage);
+
+	for (auto& mesh : layer.instances) {
+		MeshInstances& m = mesh.second;
+		if (m.lineCount > 0)
+			glBufferSubData(GL_ARRAY_BUFFER, m.lineBase * sizeof(GizmoInstance), m.lineCount * sizeof(GizmoInstance), m.lines.data());
+		if (m.triCount > 0)
+			glBufferSubData(GL_ARRAY_BUFFER, m.triBase * sizeof(GizmoInstance), m.triCount * sizeof(GizmoInstance), m.tris.data());
+		if (m.transparentTriCount > 0)
+			glBufferSubData(GL_ARRAY_BUFFER, m.transparentTriBase * sizeof(GizmoInstance), m.transparentTriCount * sizeof(GizmoInstance), m.transparentTris.data());
+	}
+}
+
+void Gizmos::uploadGroups() {
+
+	std::lock_guard<std::mutex> lock(m_groupMutex);
+
+	for (auto& group : m_groups) {
+		Layer* layer = group.second;
+		if (layer->pendingUpload == false)
+			continue;
+
+		// upload once, then give the memory back as it won't change
+		uploadLayer(*layer, GL_STATIC_DRAW);
+		uploadBuffer(layer->lines2D, GL_STATIC_DRAW);
+		uploadBuffer(layer->tris2D, GL_STATIC_DRAW);
+
+		resetBuffer(layer->lines);
+		resetBuffer(layer->tris);
+		resetBuffer(layer->transparentTris);
+		resetBuffer(layer->lines2D);
+		resetBuffer(layer->tris2D);
+		resetStream(layer->points);
+		std::vector<GizmoSegment>().swap(layer->segments);
+		std::vector<GizmoCurve>().swap(layer->curves);
+		std::vector<GizmoGlyph>().swap(layer->glyphs);
+		std::vector<GizmoGlyph>().swap(layer->overlayGlyphs);
+		std::vector<GizmoShape>().swap(layer->compute.shapes);
+		for (auto& mesh : layer->instances) {
+			std::vector<GizmoInstance>().swap(mesh.second.lines);
+			std::vector<GizmoInstance>().swap(mesh.second.tris);
+			std::vector<GizmoInstance>().swap(mesh.second.transparentTris);
+		}
+
+		layer->pendingUpload = false;
+	}
+}
+
+void Gizmos::getFrameLayers(std::vector<Layer*>& layers) {
+	layers.push_back(&m_frameLayer);
+
+	std::lock_guard<std::mutex> lock(m_threadMutex);
+	layers.insert(layers.end(), m_threadLayers.begin(), m_threadLayers.end());
+}
+
+void Gizmos::getGroupLayers(std::vector<Layer*>& layers) {
+
+	// groups being built aren't drawn until endGroup()
+	std::lock_guard<std::mutex> lock(m_groupMutex);
+	for (auto& group : m_groups) {
+		if (group.second->visible &&
+			group.second->building == false)
+			layers.push_back(group.second);
+	}
+}
+
+bool Gizmos::hasTransparent(const Layer& layer) {
+	if (layer.transparentTris.indexCount > 0 ||
+		layer.grids.empty() == false ||
+		layer.glyphCount + layer.overlayGlyphCount > 0 ||
+		(layer.compute.shapeCount > 0 && layer.compute.regionSize[1] > 0))
+		return true;
+	for (auto& mesh : layer.instances) {
+		if (mesh.second.transparentTriCount > 0)
+			return true;
+	}
+	return false;
+}
+
+void Gizmos::drawLayer(const Layer& layer, const glm::mat4& projectionView, bool transparent, bool weighted) {
+
+	glm::mat4 transform = projectionView * glm::make_mat4(layer.transform);
+
+	unsigned int shader = weighted ? m_weightedShader : m_shader;
+	glUseProgram(shader);
+	glUniformMatrix4fv(glGetUniformLocation(shader, "ProjectionView"), 1, false, glm::value_ptr(transform));
+
+	if (transparent) {
+		drawBuffer(layer.transparentTris, GL_TRIANGLES);
+		drawComputeRegion(layer.compute, 1, GL_TRIANGLES);
+
+		// grids and text blend themselves, so are drawn after the weighted triangles are resolved
+		if (weighted == false) {
+			if (layer.grids.empty() == false)
+				drawGrids(layer, transform);
+			if (layer.glyphCount + layer.overlayGlyphCount > 0)
+				drawText(layer, transform);
+		}
+	}
+	else {
+		drawBuffer(layer.lines, GL_LINES);
+		drawBuffer(layer.tris, GL_TRIANGLES);
+
+		if (layer.pointCount > 0) {
+			glBindVertexArray(layer.pointVAO);
+			glDrawArrays(GL_POINTS, 0, layer.pointCount);
+		}
+
+		drawComputeRegion(layer.compute, 0, GL_TRIANGLES);
+		drawComputeRegion(layer.compute, 2, GL_LINES);
+
+		if (layer.curveCount > 0)
+			drawCurves(layer, transform);
+
+		if (layer.segmentCount > 0)
+			drawSegments(layer, transform);
+	}
+
+	if (layer.instanceCount == 0)
+		return;
+
+	unsigned int instanceShader = weighted ? m_weightedInstanceShader : m_instanceShader;
+	glUseProgram(instanceShader);
+	glUniformMatrix4fv(glGetUniformLocation(instanceShader, "ProjectionView"), 1, false, glm::value_ptr(transform));
+
+	for (auto& iter : layer.instances) {
+		UnitMesh* mesh = iter.second.mesh;
+		const MeshInstances& m = iter.second;
+
+		if (mesh->vao == 0)
+			createMeshObjects(mesh);
+
+		glBindVertexArray(mesh->vao);
+
+		if (transparent) {
+			if (m.transparentTriCount > 0) {
+				bindInstances(layer.instanceVBO, m.transparentTriBase);
+				glDrawElementsInstanced(GL_TRIANGLES, mesh->triIndexCount, GL_UNSIGNED_INT, 0, m.transparentTriCount);
+			}
+		}
+		else {
+			if (m.triCount > 0) {
+				bindInstances(layer.instanceVBO, m.triBase);
+				glDrawElementsInstanced(GL_TRIANGLES, mesh->triIndexCount, GL_UNSIGNED_INT, 0, m.triCount);
+			}
+			if (m.lineCount > 0) {
+				bindInstances(layer.instanceVBO, m.lineBase);
+				glDrawElementsInstanced(GL_LINES, mesh->lineIndexCount, GL_UNSIGNED_INT,
+										(void*)(size_t)(mesh->triIndexCount * sizeof(unsigned int)), m.lineCount);
+			}
+		}
+	}
+}
+
+void Gizmos::addComputeShape(PatchType type, const glm::mat4& transform, float a0, float a1, float b0, float b1,
+							 unsigned int rows, unsigned int cols, unsigned int flags,
+							 const glm::vec4& colour, const glm::vec4& lineColour,
+							 const glm::vec3& boundsCenter, float boundsRadius) {
+
+	ComputeBatch& batch = getLayer()->compute;
+	batch.shapes.push_back(GizmoShape());
+	GizmoShape& shape = batch.shapes.back();
+
+	memcpy(shape.transform, glm::value_ptr(transform), sizeof(float) * 16);
+	memcpy(shape.colour, glm::value_ptr(colour), sizeof(float) * 4);
+	memcpy(shape.lineColour, glm::value_ptr(lineColour), sizeof(float) * 4);
+	shape.ranges[0] = a0;
+	shape.ranges[1] = a1;
+	shape.ranges[2] = b0;
+	shape.ranges[3] = b1;
+	memcpy(shape.bounds, glm::value_ptr(boundsCenter), sizeof(float) * 3);
+	shape.bounds[3] = boundsRadius;
+	shape.info[0] = type;
+	shape.info[1] = rows;
+	shape.info[2] = cols;
+	shape.info[3] = flags;
+
+	// the most vertices it could need, as the compute pass may cull it
+	unsigned int cells = rows * cols;
+	if (flags & SHAPE_FILLED)
+		batch.regionSize[flags & SHAPE_TRANSPARENT ? 1 : 0] += cells * (flags & SHAPE_DOUBLE_SIDED ? 12 : 6);
+	if (flags & SHAPE_GRID_LINES)
+		batch.regionSize[2] += cells * 8;
+	else if (flags & SHAPE_BORDER_LINES)
+		batch.regionSize[2] += (rows + cols) * 4;
+}
+
+void Gizmos::uploadComputeBatch(ComputeBatch& batch, unsigned int usage) {
+
+	batch.shapeCount = (unsigned int)batch.shapes.size();
+	if (batch.shapeCount == 0)
+		return;
+
+	if (batch.vao == 0) {
+		glGenBuffers(1, &batch.shapeBuffer);
+		glGenBuffers(1, &batch.vertexBuffer);
+		glGenBuffers(1, &batch.commandBuffer);
+
+		// the expanded vertices match GizmoVertex
+		glGenVertexArrays(1, &batch.vao);
+		glBindVertexArray(batch.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, batch.vertexBuffer);
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), 0);
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GizmoVertex), (void*)12);
+
+		glBindBuffer(GL_ARRAY_BUFFER, batch.commandBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(unsigned int) * 12, nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.shapeBuffer);
+	if (batch.shapeCount > batch.shapeCapacity) {
+		if (batch.shapeCapacity == 0)
+			batch.shapeCapacity = 64;
+		while (batch.shapeCapacity < batch.shapeCount)
+			batch.shapeCapacity *= 2;
+	}
+	glBufferData(GL_SHADER_STORAGE_BUFFER, batch.shapeCapacity * sizeof(GizmoShape), nullptr, usage);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, batch.shapeCount * sizeof(GizmoShape), batch.shapes.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// opaque triangles, transparent triangles then lines share the vertex buffer
+	batch.regionFirst[0] = 0;
+	batch.regionFirst[1] = batch.regionSize[0];
+	batch.regionFirst[2] = batch.regionFirst[1] + batch.regionSize[1];
+
+	unsigned int total = batch.regionFirst[2] + batch.regionSize[2];
+	if (total > batch.vertexCapacity) {
+		if (batch.vertexCapacity == 0)
+			batch.vertexCapacity = 4096;
+		while (batch.vertexCapacity < total)
+			batch.vertexCapacity *= 2;
+
+		glBindBuffer(GL_ARRAY_BUFFER, batch.vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, batch.vertexCapacity * sizeof(GizmoVertex), nullptr, GL_DYNAMIC_COPY);
+	}
+}
+
+void Gizmos::expandComputeBatch(const ComputeBatch& batch, const glm::mat4& projectionView) {
+
+	// reset the draw commands, which the compute pass counts up
+	unsigned int commands[12] = {};
+	for (unsigned int i = 0; i < 3; ++i) {
+		commands[i * 4 + 1] = 1;
+		commands[i * 4 + 2] = batch.regionFirst[i];
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, batch.commandBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(commands), commands);
+
+	// culled against the frustum in the batch's own space
+	float frustum[6][4];
+	getFrustum(projectionView, frustum);
+
+	glUseProgram(m_computeShader);
+	glUniform4fv(glGetUniformLocation(m_computeShader, "Frustum"), 6, frustum[0]);
+	int shapeBaseUniform = glGetUniformLocation(m_computeShader, "ShapeBase");
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, batch.shapeBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batch.vertexBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, batch.commandBuffer);
+
+	// work group counts are limited, so large batches dispatch in pieces
+	for (unsigned int base = 0; base < batch.shapeCount; base += 65535) {
+		unsigned int count = batch.shapeCount - base < 65535 ? batch.shapeCount - base : 65535;
+		glUniform1ui(shapeBaseUniform, base);
+		glDispatchCompute(count, 1, 1);
+	}
+}
+
+void Gizmos::drawComputeRegion(const ComputeBatch& batch, unsigned int region, unsigned int mode) {
+	if (batch.shapeCount > 0 &&
+		batch.regionSize[region] > 0) {
+		glBindVertexArray(batch.vao);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.commandBuffer);
+		glDrawArraysIndirect(mode, (void*)(size_t)(region * sizeof(unsigned int) * 4));
+	}
+}
+
+// true if the bound draw framebuffer's depth can be blitted into a DEPTH24_STENCIL8 target,
+// which needs the same format and no multisampling
+static bool canCopyDepth(int framebuffer) {
+
+	int samples = 0;
+	glGetIntegerv(GL_SAMPLES, &samples);
+	if (samples > 0)
+		return false;
+
+	// the back buffer's depth is named differently to an attachment
+	GLenum attachment = framebuffer == 0 ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+	int type = GL_NONE;
+	glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+	if (type == GL_NONE)
+		return false;
+
+	int depthBits = 0, stencilBits = 0, componentType = 0;
+	glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depthBits);
+	glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &componentType);
+	glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, framebuffer == 0 ? GL_STENCIL : GL_STENCIL_ATTACHMENT,
+										  GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+	if (type != GL_NONE)
+		glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, framebuffer == 0 ? GL_STENCIL : GL_STENCIL_ATTACHMENT,
+											  GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencilBits);
+
+	return depthBits == 24 && stencilBits == 8 && componentType == GL_UNSIGNED_NORMALIZED;
+}
+
+bool Gizmos::drawWeighted(const std::vector<Layer*>& layers, const glm::mat4& projectionView) {
+
+	// the targets match the viewport being drawn to
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int framebuffer = 0, readFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+
+	// without a depth buffer that can be copied, opaque geometry couldn't hide the
+	// transparent triangles, so they're blended in order instead
+	if (canCopyDepth(framebuffer) == false)
+		return false;
+
+	if (m_weightedFBO == 0 ||
+		m_weightedWidth != viewport[2] ||
+		m_weightedHeight != viewport[3]) {
+		if (m_weightedFBO == 0) {
+			glGenFramebuffers(1, &m_weightedFBO);
+			glGenTextures(2, m_weightedTargets);
+			glGenRenderbuffers(1, &m_weightedDepth);
+		}
+
+		m_weightedWidth = viewport[2];
+		m_weightedHeight = viewport[3];
+
+		int texture = 0;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+
+		unsigned int formats[] = { GL_RGBA16F, GL_R16F };
+		unsigned int channels[] = { GL_RGBA, GL_RED };
+		for (int i = 0; i < 2; ++i) {
+			glBindTexture(GL_TEXTURE_2D, m_weightedTargets[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, formats[i], m_weightedWidth, m_weightedHeight, 0, channels[i], GL_FLOAT, 0);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		glBindTexture(GL_TEXTURE_2D, texture);
+
+		// the same format as the back buffer and render targets, so their depth can be copied in
+		glBindRenderbuffer(GL_RENDERBUFFER, m_weightedDepth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_weightedWidth, m_weightedHeight);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_weightedFBO);
+		glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_weightedTargets[0], 0);
+		glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, m_weightedTargets[1], 0);
+		glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_weightedDepth);
+
+		GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, drawBuffers);
+
+		if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			printf("Error: Failed to create Gizmo transparency targets!\n");
+	}
+
+	// opaque geometry still hides the transparent triangles
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_weightedFBO);
+	glBlitFramebuffer(viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+					  0, 0, m_weightedWidth, m_weightedHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+	float accumulation[] = { 0, 0, 0, 0 };
+	float revealage[] = { 1, 1, 1, 1 };
+	glClearBufferfv(GL_COLOR, 0, accumulation);
+	glClearBufferfv(GL_COLOR, 1, revealage);
+
+	glViewport(0, 0, m_weightedWidth, m_weightedHeight);
+	glBlendFunci(0, GL_ONE, GL_ONE);
+	glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+
+	for (auto layer : layers)
+		drawLayer(*layer, projectionView, true, true);
+
+	// blend the average colour over what was drawn before
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+	GLboolean depthEnabled = glIsEnabled(GL_DEPTH_TEST);
+	glDisable(GL_DEPTH_TEST);
+
+	int activeTexture = 0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+	int textures[2];
+	for (int i = 0; i < 2; ++i) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &textures[i]);
+		glBindTexture(GL_TEXTURE_2D, m_weightedTargets[i]);
+	}
+
+	glUseProgram(m_resolveShader);
+	glUniform2i(glGetUniformLocation(m_resolveShader, "Origin"), viewport[0], viewport[1]);
+	glBindVertexArray(m_gridVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	for (int i = 0; i < 2; ++i) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+	glActiveTexture(activeTexture);
+
+	if (depthEnabled == GL_TRUE)
+		glEnable(GL_DEPTH_TEST);
+	return true;
+}
+
+inline bool Gizmos::isChannelActive() {
+	return sm_singleton != nullptr &&
+		   (sm_singleton->m_channelMask.load(std::memory_order_relaxed) & (1ull << sm_channel)) != 0;
+}
+
+unsigned int Gizmos::registerChannel(const char* name) {
+	if (sm_singleton == nullptr)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(sm_singleton->m_channelMutex);
+	auto& names = sm_singleton->m_channelNames;
+	for (unsigned int i = 0; i < names.size(); ++i) {
+		if (names[i] == name)
+			return i;
+	}
+
+	if (names.size() == 64)
+		return 0;
+
+	names.push_back(name);
+	return (unsigned int)names.size() - 1;
+}
+
+unsigned int Gizmos::findChannel(const char* name) {
+	if (sm_singleton == nullptr)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(sm_singleton->m_channelMutex);
+	auto& names = sm_singleton->m_channelNames;
+	for (unsigned int i = 0; i < names.size(); ++i) {
+		if (names[i] == name)
+			return i;
+	}
+	return 0;
+}
+
+void Gizmos::setChannel(unsigned int channel) {
+	sm_channel = channel < 64 ? channel : 0;
+}
+
+void Gizmos::setChannelEnabled(unsigned int channel, bool enabled) {
+	if (sm_singleton == nullptr || channel >= 64)
+		return;
+
+	if (enabled)
+		sm_singleton->m_channelMask.fetch_or(1ull << channel);
+	else
+		sm_singleton->m_channelMask.fetch_and(~(1ull << channel));
+}
+
+bool Gizmos::isChannelEnabled(unsigned int channel) {
+	return sm_singleton != nullptr && channel < 64 &&
+		   (sm_singleton->m_channelMask.load() & (1ull << channel)) != 0;
+}
+
+void Gizmos::setWeightedTransparency(bool enabled) {
+	if (sm_singleton != nullptr)
+		sm_singleton->m_weightedTransparency = enabled && ogl_IsVersionGEQ(4, 0);
+}
+
+void Gizmos::setComputeTessellation(bool enabled) {
+	if (sm_singleton != nullptr)
+		sm_singleton->m_computeTessellation = enabled && sm_singleton->m_computeShader != 0;
+}
+
+void Gizmos::drawSegments(const Layer& layer, const glm::mat4& projectionView) {
+
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glUseProgram(m_segmentShader);
+	glUniformMatrix4fv(glGetUniformLocation(m_segmentShader, "ProjectionView"), 1, false, glm::value_ptr(projectionView));
+	glUniform2f(glGetUniformLocation(m_segmentShader, "ViewportSize"), (float)viewport[2], (float)viewport[3]);
+
+	glBindVertexArray(m_segmentVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, layer.segmentVBO);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GizmoSegment), (void*)24);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(GizmoSegment), 0);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(GizmoSegment), (void*)12);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(GizmoSegment), (void*)28);
+
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 9, layer.segmentCount);
+
+	glUseProgram(m_shader);
+}
+
+void Gizmos::drawGrids(const Layer& layer, const glm::mat4& projectionView) {
+
+	// grids are in the layer's space, so the rays are too
+	glm::mat4 inverse = glm::inverse(projectionView);
+
+	glUseProgram(m_gridShader);
+	glUniformMatrix4fv(glGetUniformLocation(m_gridShader, "ProjectionView"), 1, false, glm::value_ptr(projectionView));
+	glUniformMatrix4fv(glGetUniformLocation(m_gridShader, "InverseProjectionView"), 1, false, glm::value_ptr(inverse));
+
+	int centerUniform = glGetUniformLocation(m_gridShader, "Center");
+	int axisUUniform = glGetUniformLocation(m_gridShader, "AxisU");
+	int axisVUniform = glGetUniformLocation(m_gridShader, "AxisV");
+	int spacingUniform = glGetUniformLocation(m_gridShader, "Spacing");
+	int extentUniform = glGetUniformLocation(m_gridShader, "Extent");
+	int colourUniform = glGetUniformLocation(m_gridShader, "Colour");
+	int axisColourUniform = glGetUniformLocation(m_gridShader, "AxisColour");
+
+	glBindVertexArray(m_gridVAO);
+
+	for (auto& grid : layer.grids) {
+		glUniform3fv(centerUniform, 1, grid.center);
+		glUniform3fv(axisUUniform, 1, grid.axisU);
+		glUniform3fv(axisVUniform, 1, grid.axisV);
+		glUniform1f(spacingUniform, grid.spacing);
+		glUniform1f(extentUniform, grid.extent);
+		glUniform4fv(colourUniform, 1, grid.colour);
+		glUniform4fv(axisColourUniform, 1, grid.axisColour);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+}
+
+void Gizmos::bindInstances(unsigned int vbo, unsigned int base) {
+
+	size_t offset = base * sizeof(GizmoInstance);
+
+	// per-instance transform, colour and params
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GizmoInstance), (void*)(offset + 64));
+	for (unsigned int i = 0; i < 4; ++i)
+		glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoInstance), (void*)(offset + i * 16));
+	glVertexAttribPointer(6, 2, GL_FLOAT, GL_FALSE, sizeof(GizmoInstance), (void*)(offset + 68));
+}
+
+Gizmos::ThreadLayers::~ThreadLayers() {
+
+	// what the thread added this frame is still drawn, and the layer goes at the next clear()
+	if (sm_singleton != nullptr &&
+		generation == sm_generation &&
+		frame != nullptr &&
+		frame != &sm_singleton->m_frameLayer) {
+		std::lock_guard<std::mutex> lock(sm_singleton->m_threadMutex);
+		frame->abandoned = true;
+	}
+}
+
+Gizmos::Layer* Gizmos::getLayer() {
+
+	// each thread adds to its own layer, made the first time it adds anything
+	if (sm_threadLayers.generation != sm_generation) {
+		Layer* layer = new Layer();
+		initLayer(*layer, 0, 0, 0, 0);
+
+		std::lock_guard<std::mutex> lock(m_threadMutex);
+		m_threadLayers.push_back(layer);
+
+		sm_threadLayers.generation = sm_generation;
+		sm_threadLayers.frame = layer;
+		sm_threadLayers.current = layer;
+	}
+
+	return sm_threadLayers.current;
+}
+
+unsigned int Gizmos::beginGroup() {
+	if (sm_singleton == nullptr ||
+		sm_singleton->getLayer()->building)
+		return 0;
+
+	Layer* layer = new Layer();
+	sm_singleton->initLayer(*layer, 0, 0, 0, 0);
+	layer->building = true;
+
+	sm_threadLayers.current = layer;
+
+	std::lock_guard<std::mutex> lock(sm_singleton->m_groupMutex);
+	unsigned int group = sm_singleton->m_nextGroup++;
+	sm_singleton->m_groups[group] = layer;
+	return group;
+}
+
+void Gizmos::endGroup() {
+	if (sm_singleton == nullptr ||
+		sm_singleton->getLayer()->building == false)
+		return;
+
+	// uploaded by the next draw, which may be on another thread
+	std::lock_guard<std::mutex> lock(sm_singleton->m_groupMutex);
+	sm_threadLayers.current->building = false;
+	sm_threadLayers.current->pendingUpload = true;
+	sm_threadLayers.current = sm_threadLayers.frame;
+}
+
+void Gizmos::removeGroup(unsigned int group) {
+	if (sm_singleton == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(sm_singleton->m_groupMutex);
+	auto iter = sm_singleton->m_groups.find(group);
+	if (iter != sm_singleton->m_groups.end() &&
+		iter->second->building == false) {
+		sm_singleton->destroyLayer(*iter->second);
+		delete iter->second;
+		sm_singleton->m_groups.erase(iter);
+	}
+}
+
+void Gizmos::setGroupTransform(unsigned int group, const glm::mat4& transform) {
+	if (sm_singleton == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(sm_singleton->m_groupMutex);
+	auto iter = sm_singleton->m_groups.find(group);
+	if (iter != sm_singleton->m_groups.end())
+		memcpy(iter->second->transform, glm::value_ptr(transform), sizeof(float) * 16);
+}
+
+void Gizmos::setGroupVisible(unsigned int group, bool visible) {
+	if (sm_singleton == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(sm_singleton->m_groupMutex);
+	auto iter = sm_singleton->m_groups.find(group);
+	if (iter != sm_singleton->m_groups.end())
+		iter->second->visible = visible;
+}
+
+void Gizmos::initTimedRing(TimedRing& ring, unsigned int verticesPerPrimitive) {
+	ring.verticesPerPrimitive = verticesPerPrimitive;
+	ring.tail = 0;
+	ring.count = 0;
+	ring.vao = 0;
+	ring.vbo = 0;
+}
+
+void Gizmos::destroyTimedRing(TimedRing& ring) {
+	if (ring.vbo != 0)
+		glDeleteBuffers(1, &ring.vbo);
+	if (ring.vao != 0)
+		glDeleteVertexArrays(1, &ring.vao);
+}
+
+void Gizmos::addTimed(TimedRing& ring, const glm::vec3* positions, const glm::vec4& colour, float duration) {
+
+	float expiry = getTime() + duration;
+
+	// the ring belongs to the drawing thread, so other threads only add to the pending list
+	std::lock_guard<std::mutex> lock(m_timedMutex);
+	for (unsigned int i = 0; i < ring.verticesPerPrimitive; ++i) {
+		ring.pending.push_back(TimedVertex());
+		TimedVertex& vertex = ring.pending.back();
+		vertex.x = positions[i].x;
+		vertex.y = positions[i].y;
+		vertex.z = positions[i].z;
+		vertex.r = toByte(colour.r);
+		vertex.g = toByte(colour.g);
+		vertex.b = toByte(colour.b);
+		vertex.a = toByte(colour.a);
+		vertex.expiry = expiry;
+	}
+}
+
+void Gizmos::updateTimedRing(TimedRing& ring, float time) {
+
+	std::vector<TimedVertex> pending;
+	{
+		std::lock_guard<std::mutex> lock(m_timedMutex);
+		pending.swap(ring.pending);
+	}
+
+	unsigned int capacity = (unsigned int)ring.vertices.size();
+
+	// reclaim space lazily, only while the oldest has expired.
+	// the shader hides the rest when they expire
+	while (ring.count > 0 &&
+		   ring.vertices[ring.tail].expiry <= time) {
+		ring.tail = (ring.tail + ring.verticesPerPrimitive) % capacity;
+		ring.count -= ring.verticesPerPrimitive;
+	}
+
+	if (pending.empty())
+		return;
+
+	if (ring.vao == 0) {
+		glGenBuffers(1, &ring.vbo);
+
+		glGenVertexArrays(1, &ring.vao);
+		glBindVertexArray(ring.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, ring.vbo);
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(7);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TimedVertex), 0);
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TimedVertex), (void*)12);
+		glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(TimedVertex), (void*)16);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, ring.vbo);
+
+	unsigned int needed = ring.count + (unsigned int)pending.size();
+	if (needed > capacity) {
+		// grow, straightening out the live entries, and upload the lot
+		unsigned int newCapacity = capacity > 0 ? capacity : ring.verticesPerPrimitive * 1024;
+		while (newCapacity < needed)
+			newCapacity *= 2;
+
+		std::vector<TimedVertex> vertices(newCapacity);
+		for (unsigned int i = 0; i < ring.count; ++i)
+			vertices[i] = ring.vertices[(ring.tail + i) % capacity];
+		std::copy(pending.begin(), pending.end(), vertices.begin() + ring.count);
+
+		ring.vertices.swap(vertices);
+		ring.tail = 0;
+		ring.count = needed;
+
+		glBufferData(GL_ARRAY_BUFFER, newCapacity * sizeof(TimedVertex), ring.vertices.data(), GL_DYNAMIC_DRAW);
+		return;
+	}
+
+	// only the new entries are uploaded, in at most two pieces where they wrap around
+	unsigned int head = (ring.tail + ring.count) % capacity;
+	unsigned int first = capacity - head;
+	if (first > pending.size())
+		first = (unsigned int)pending.size();
+
+	std::copy(pending.begin(), pending.begin() + first, ring.vertices.begin() + head);
+	glBufferSubData(GL_ARRAY_BUFFER, head * sizeof(TimedVertex), first * sizeof(TimedVertex), pending.data());
+
+	unsigned int second = (unsigned int)pending.size() - first;
+	if (second > 0) {
+		std::copy(pending.begin() + first, pending.end(), ring.vertices.begin());
+		glBufferSubData(GL_ARRAY_BUFFER, 0, second * sizeof(TimedVertex), pending.data() + first);
+	}
+
+	ring.count = needed;
+}
+
+void Gizmos::drawTimedRing(const TimedRing& ring, unsigned int mode) {
+	if (ring.count == 0)
+		return;
+
+	unsigned int capacity = (unsigned int)ring.vertices.size();
+	unsigned int first = capacity - ring.tail;
+	if (first > ring.count)
+		first = ring.count;
+
+	glBindVertexArray(ring.vao);
+	glDrawArrays(mode, ring.tail, first);
+	if (ring.count > first)
+		glDrawArrays(mode, 0, ring.count - first);
+}
+
+float Gizmos::getTime() const {
+	return std::chrono::duration<float>(std::chrono::steady_clock::now() - m_startTime).count();
+}
+
+void Gizmos::clearTimed() {
+	if (sm_singleton == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(sm_singleton->m_timedMutex);
+	for (auto ring : { &sm_singleton->m_timedLines, &sm_singleton->m_timedTris }) {
+		ring->pending.clear();
+		ring->tail = 0;
+		ring->count = 0;
+	}
+}
+
 void Gizmos::create(unsigned int maxLines, unsigned int maxTris,
 					unsigned int max2DLines, unsigned int max2DTris) {
 	if (sm_singleton == nullptr)
 		sm_singleton = new Gizmos(maxLines,maxTris,max2DLines,max2DTris);
 }
 
-void Gizmos::destroy() {
-	delete sm_singleton;
-	sm_singleton = nullptr;
+void Gizmos::destroy() {
+	delete sm_singleton;
+	sm_singleton = nullptr;
+}
+
+void Gizmos::clear() {
+	sm_singleton->resetLayer(sm_singleton->m_frameLayer);
+
+	// layers of threads that have exited are deleted rather than kept for reuse
+	std::lock_guard<std::mutex> lock(sm_singleton->m_threadMutex);
+	auto& layers = sm_singleton->m_threadLayers;
+	size_t kept = 0;
+	for (auto layer : layers) {
+		if (layer->abandoned) {
+			sm_singleton->destroyLayer(*layer);
+			delete layer;
+		}
+		else {
+			sm_singleton->resetLayer(*layer);
+			layers[kept++] = layer;
+		}
+	}
+	layers.resize(kept);
+}
+
+Gizmos::Statistics Gizmos::getCounts() {
+	Statistics stats = {};
+	if (sm_singleton != nullptr) {
+		std::vector<Layer*> layers;
+		sm_singleton->getFrameLayers(layers);
+
+		for (auto layer : layers) {
+			stats.lines += layer->lines.indices.count / 2;
+			stats.tris += layer->tris.indices.count / 3;
+			stats.transparentTris += layer->transparentTris.indices.count / 3;
+			stats.lines2D += layer->lines2D.indices.count / 2;
+			stats.tris2D += layer->tris2D.indices.count / 3;
+			stats.points += layer->points.count;
+			stats.shapes += layer->instanceCount;
+		}
+	}
+	return stats;
+}
+
+Gizmos::Statistics Gizmos::getHighWaterMarks() {
+	Statistics stats = {};
+	if (sm_singleton != nullptr) {
+		std::vector<Layer*> layers;
+		sm_singleton->getFrameLayers(layers);
+
+		for (auto layer : layers) {
+			stats.lines += layer->lines.indices.highWaterMark / 2;
+			stats.tris += layer->tris.indices.highWaterMark / 3;
+			stats.transparentTris += layer->transparentTris.indices.highWaterMark / 3;
+			stats.lines2D += layer->lines2D.indices.highWaterMark / 2;
+			stats.tris2D += layer->tris2D.indices.highWaterMark / 3;
+			stats.points += layer->points.highWaterMark;
+			stats.shapes += layer->instanceHighWaterMark;
+		}
+	}
+	return stats;
+}
+
+void Gizmos::setCamera(const glm::mat4& projection, const glm::mat4& view, float viewportHeight, float tolerance) {
+	if (sm_singleton == nullptr)
+		return;
+
+	getFrustum(projection * view, sm_singleton->m_frustum);
+
+	glm::vec3 position(glm::inverse(view)[3]);
+	memcpy(sm_singleton->m_cameraPosition, glm::value_ptr(position), sizeof(float) * 3);
+
+	// pixels per world unit, at a distance of 1 for perspective projections
+	sm_singleton->m_pixelScale = projection[1][1] * viewportHeight * 0.5f;
+	sm_singleton->m_perspective = projection[2][3] != 0;
+	sm_singleton->m_tolerance = tolerance;
+	sm_singleton->m_hasCamera = true;
+}
+
+void Gizmos::clearCamera() {
+	if (sm_singleton != nullptr)
+		sm_singleton->m_hasCamera = false;
+}
+
+bool Gizmos::isCulled(const glm::vec3& center, float radius) {
+
+	// groups may be drawn from anywhere
+	if (m_hasCamera == false ||
+		getLayer()->building)
+		return false;
+
+	for (auto& plane : m_frustum) {
+		if (plane[0] * center.x + plane[1] * center.y + plane[2] * center.z + plane[3] < -radius)
+			return true;
+	}
+	return false;
+}
+
+unsigned int Gizmos::getSegments(const glm::vec3& center, float radius, unsigned int segments, float angle) {
+
+	if (m_hasCamera == false ||
+		getLayer()->building)
+		return segments;
+
+	float pixels = radius * m_pixelScale;
+	if (m_perspective) {
+		float distance = glm::distance(center, glm::make_vec3(m_cameraPosition));
+		pixels /= distance > 0.0001f ? distance : 0.0001f;
+	}
+
+	// the segments a full circle needs so its edges stray no more than the tolerance,
+	// rounded up to 4, 6, 8, 12, 16, 24... so unit meshes and tables are shared
+	unsigned int needed = 4;
+	if (pixels > m_tolerance) {
+		float count = glm::pi<float>() / acosf(1 - m_tolerance / pixels);
+		while (needed < count && needed < segments)
+			needed = (needed & (needed - 1)) == 0 ? needed + needed / 2 : needed / 3 * 4;
+	}
+
+	// arcs only need their share
+	needed = (unsigned int)ceilf(needed * angle / (2 * glm::pi<float>()));
+	if (needed < 1)
+		needed = 1;
+
+	return needed < segments ? needed : segments;
+}
+
+const float* Gizmos::getCircle(unsigned int segments) {
+
+	std::lock_guard<std::mutex> lock(m_circleMutex);
+
+	std::vector<float>& circle = m_circles[segments];
+	if (circle.empty()) {
+		float segmentSize = (2 * glm::pi<float>()) / segments;
+
+		circle.resize(segments * 2);
+		for (unsigned int i = 0; i < segments; ++i) {
+			circle[i * 2] = sinf(i * segmentSize);
+			circle[i * 2 + 1] = cosf(i * segmentSize);
+		}
+	}
+	return circle.data();
+}
+
+static inline unsigned long long meshKey(unsigned char shape, unsigned int rows, unsigned int cols) {
+	return (unsigned long long)shape | ((unsigned long long)rows << 8) | ((unsigned long long)cols << 32);
+}
+
+Gizmos::UnitMesh* Gizmos::getUnitMesh(Shape shape, unsigned int rows, unsigned int cols) {
+
+	// the cache is shared by every thread's layers
+	std::lock_guard<std::mutex> lock(m_meshMutex);
+
+	unsigned long long key = meshKey(shape, rows, cols);
+
+	auto iter = m_unitMeshes.find(key);
+	if (iter != m_unitMeshes.end())
+		return iter->second;
+
+	// x,y,z positions of a unit-sized shape, with w tagging vertices that the instance params move
+	std::vector<glm::vec4> vertices;
+	std::vector<unsigned int> triIndices;
+	std::vector<unsigned int> lineIndices;
+
+	const float* circle = getCircle(cols);
+
+	switch (shape) {
+	case CYLINDER: {
+		// centres, then the top and bottom rings
+		vertices.push_back(glm::vec4(0, 1, 0, 0));
+		vertices.push_back(glm::vec4(0, -1, 0, 0));
+		for (unsigned int i = 0; i < cols; ++i)
+			vertices.push_back(glm::vec4(circle[i * 2], 1, circle[i * 2 + 1], 0));
+		for (unsigned int i = 0; i < cols; ++i)
+			vertices.push_back(glm::vec4(circle[i * 2], -1, circle[i * 2 + 1], 0));
+
+		for (unsigned int i = 0; i < cols; ++i) {
+			unsigned int t1 = 2 + i;
+			unsigned int t2 = 2 + (i + 1) % cols;
+			unsigned int b1 = t1 + cols;
+			unsigned int b2 = t2 + cols;
+
+			unsigned int tris[] = { 0, t1, t2,  1, b2, b1,  t2, t1, b1,  b1, b2, t2 };
+			unsigned int lines[] = { t1, t2,  t1, b1,  b1, b2 };
+			triIndices.insert(triIndices.end(), tris, tris + 12);
+			lineIndices.insert(lineIndices.end(), lines, lines + 6);
+		}
+		break;
+	}
+	case DISK: {
+		vertices.push_back(glm::vec4(0, 0, 0, 0));
+		for (unsigned int i = 0; i < cols; ++i)
+			vertices.push_back(glm::vec4(circle[i * 2], 0, circle[i * 2 + 1], 0));
+
+		// double-sided
+		for (unsigned int i = 0; i < cols; ++i) {
+			unsigned int v1 = 1 + i;
+			unsigned int v2 = 1 + (i + 1) % cols;
+
+			unsigned int tris[] = { 0, v1, v2,  v2, v1, 0 };
+			unsigned int lines[] = { v1, v2 };
+			triIndices.insert(triIndices.end(), tris, tris + 6);
+			lineIndices.insert(lineIndices.end(), lines, lines + 2);
+		}
+		break;
+	}
+	case RING: {
+		// outer ring, then the inner ring which is scaled by the inner / outer radius ratio
+		for (unsigned int i = 0; i < cols; ++i)
+			vertices.push_back(glm::vec4(circle[i * 2], 0, circle[i * 2 + 1], 0));
+		for (unsigned int i = 0; i < cols; ++i)
+			vertices.push_back(glm::vec4(circle[i * 2], 0, circle[i * 2 + 1], 1));
+
+		// double-sided
+		for (unsigned int i = 0; i < cols; ++i) {
+			unsigned int o1 = i;
+			unsigned int o2 = (i + 1) % cols;
+			unsigned int i1 = o1 + cols;
+			unsigned int i2 = o2 + cols;
+
+			unsigned int tris[] = { o2, o1, i1,  i1, i2, o2,  i1, o1, o2,  o2, i2, i1 };
+			unsigned int lines[] = { i1, i2,  o1, o2 };
+			triIndices.insert(triIndices.end(), tris, tris + 12);
+			lineIndices.insert(lineIndices.end(), lines, lines + 4);
+		}
+		break;
+	}
+	case SPHERE:
+	case CAPSULE: {
+		// capsules split the sphere at the middle row, and the halves are pushed apart by the instance params
+		unsigned int half = shape == CAPSULE ? rows / 2 : rows + 1;
+
+		for (unsigned int row = 0; row <= rows; ++row) {
+			float radiansAboutXAxis = float(row) / rows * glm::pi<float>() - glm::half_pi<float>();
+			float y = sinf(radiansAboutXAxis);
+			float z = cosf(radiansAboutXAxis);
+
+			for (unsigned int col = 0; col < cols; ++col) {
+				float tag = shape == SPHERE ? 0.0f : row <= half ? 3.0f : 2.0f;
+				vertices.push_back(glm::vec4(-z * circle[col * 2], y, -z * circle[col * 2 + 1], tag));
+			}
+
+			// the middle row is shared, so capsules store it for both halves
+			if (row == half && shape == CAPSULE) {
+				for (unsigned int col = 0; col < cols; ++col) {
+					glm::vec4 v = vertices[vertices.size() - cols];
+					v.w = 2;
+					vertices.push_back(v);
+				}
+			}
+		}
+
+		for (unsigned int face = 0; face < rows * cols; ++face) {
+			unsigned int row = face / cols;
+			unsigned int nextFace = (face + 1) % cols == 0 ? face + 1 - cols : face + 1;
+
+			// faces above the split use the copied middle row
+			unsigned int offset = shape == CAPSULE && row >= half ? cols : 0;
+
+			unsigned int v0 = face + offset;
+			unsigned int v1 = nextFace + offset;
+			unsigned int v2 = face + cols + offset;
+			unsigned int v3 = nextFace + cols + offset;
+
+			unsigned int tris[] = { v3, v0, v1,  v3, v2, v0 };
+			unsigned int lines[] = { v0, v2,  v3, v2 };
+			triIndices.insert(triIndices.end(), tris, tris + 6);
+			lineIndices.insert(lineIndices.end(), lines, lines + 4);
+		}
+
+		// the cylinder between the halves
+		if (shape == CAPSULE) {
+			unsigned int base = (unsigned int)vertices.size();
+			for (unsigned int i = 0; i < cols; ++i)
+				vertices.push_back(glm::vec4(circle[i * 2 + 1], 0, circle[i * 2], 2));
+			for (unsigned int i = 0; i < cols; ++i)
+				vertices.push_back(glm::vec4(circle[i * 2 + 1], 0, circle[i * 2], 3));
+
+			for (unsigned int i = 0; i < cols; ++i) {
+				unsigned int t0 = base + i;
+				unsigned int t1 = base + (i + 1) % cols;
+				unsigned int b0 = t0 + cols;
+				unsigned int b1 = t1 + cols;
+
+				unsigned int tris[] = { t1, b1, b0,  t1, b0, t0 };
+				unsigned int lines[] = { t0, t1,  b0, b1,  t0, b0 };
+				triIndices.insert(triIndices.end(), tris, tris + 6);
+				lineIndices.insert(lineIndices.end(), lines, lines + 6);
+			}
+		}
+		break;
+	}
+	};
+
+	UnitMesh* mesh = new UnitMesh();
+	mesh->triIndexCount = (unsigned int)triIndices.size();
+	mesh->lineIndexCount = (unsigned int)lineIndices.size();
+
+	mesh->vertices.assign(glm::value_ptr(vertices[0]), glm::value_ptr(vertices[0]) + vertices.size() * 4);
+
+	// lines follow the triangles in the one index buffer
+	mesh->indices.swap(triIndices);
+	mesh->indices.insert(mesh->indices.end(), lineIndices.begin(), lineIndices.end());
+
+	// GL objects are made by the first draw using the mesh
+	mesh->vao = 0;
+	mesh->vbo = 0;
+	mesh->ibo = 0;
+
+	m_unitMeshes[key] = mesh;
+	return mesh;
+}
+
+void Gizmos::createMeshObjects(UnitMesh* mesh) {
+
+	glGenVertexArrays(1, &mesh->vao);
+	glBindVertexArray(mesh->vao);
+
+	glGenBuffers(1, &mesh->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+	glBufferData(GL_ARRAY_BUFFER, mesh->vertices.size() * sizeof(float), mesh->vertices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &mesh->ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(unsigned int), mesh->indices.data(), GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 4, 0);
+
+	// per-instance colour, transform and params, which bindInstances() points at a layer's buffer
+	for (unsigned int i = 1; i <= 6; ++i) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+
+	// the GPU has its own copy now
+	std::vector<float>().swap(mesh->vertices);
+	std::vector<unsigned int>().swap(mesh->indices);
+}
+
+Gizmos::MeshInstances* Gizmos::getInstances(Layer* layer, Shape shape, unsigned int rows, unsigned int cols) {
+
+	// only a layer's first use of a mesh needs the shared cache
+	MeshInstances& instances = layer->instances[meshKey(shape, rows, cols)];
+	if (instances.mesh == nullptr)
+		instances.mesh = getUnitMesh(shape, rows, cols);
+	return &instances;
+}
+
+void Gizmos::addInstance(Layer& layer, std::vector<GizmoInstance>& instances, const glm::mat4& transform,
+						 const glm::vec4& colour, float param0, float param1) {
+
+	instances.push_back(GizmoInstance());
+	GizmoInstance& instance = instances.back();
+
+	memcpy(instance.transform, glm::value_ptr(transform), sizeof(float) * 16);
+	instance.r = toByte(colour.r);
+	instance.g = toByte(colour.g);
+	instance.b = toByte(colour.b);
+	instance.a = toByte(colour.a);
+	instance.params[0] = param0;
+	instance.params[1] = param1;
+
+	layer.instanceCount++;
+	if (layer.instanceCount > layer.instanceHighWaterMark)
+		layer.instanceHighWaterMark = layer.instanceCount;
 }
 
-void Gizmos::clear() {
-	sm_singleton->m_lineCount = 0;
-	sm_singleton->m_triCount = 0;
-	sm_singleton->m_transparentTriCount = 0;
-	sm_singleton->m_2DlineCount = 0;
-	sm_singleton->m_2DtriCount = 0;
+// box corners are shared between the edges and faces
+static const unsigned int sm_boxLineIndices[24] = {
+	0, 1,  1, 2,  2, 3,  3, 0,
+	4, 5,  5, 6,  6, 7,  7, 4,
+	0, 4,  1, 5,  2, 6,  3, 7,
+};
+
+static const unsigned int sm_boxTriIndices[36] = {
+	2, 1, 0,  3, 2, 0,	// top
+	5, 6, 4,  6, 7, 4,	// bottom
+	4, 3, 0,  7, 3, 4,	// front
+	1, 2, 5,  2, 6, 5,	// back
+	0, 1, 4,  1, 5, 4,	// left
+	2, 3, 7,  6, 2, 7,	// right
+};
+
+// builds a shape's instance transform from the centre, optional rotation and scale used by the add* calls
+static glm::mat4 shapeTransform(const glm::vec3& center, const glm::mat4* rotation, const glm::vec3& scale) {
+	glm::mat4 m = glm::translate(glm::mat4(1), center);
+	if (rotation != nullptr)
+		m = m * glm::mat4(glm::mat3(*rotation));
+	return glm::scale(m, scale);
 }
 
 // Adds 3 unit-length lines (red,green,blue) representing the 3 axis of a transform, 
 // at the transform's translation. Optional scale available.
 void Gizmos::addTransform(const glm::mat4& transform, float scale) {
+	if (isChannelActive() == false)
+		return;
 
 	glm::vec4 vXAxis = transform[3] + transform[0] * scale;
 	glm::vec4 vYAxis = transform[3] + transform[1] * scale;
@@ -195,6 +2127,9 @@ void Gizmos::addAABB(const glm::vec3& center,
 	const glm::vec4& colour, 
 	const glm::mat4* transform) {
 
+	if (isChannelActive() == false)
+		return;
+
 	glm::vec3 vVerts[8];
 	glm::vec3 c = center;
 	glm::vec3 vX(rvExtents.x, 0, 0);
@@ -208,6 +2143,9 @@ void Gizmos::addAABB(const glm::vec3& center,
 		c = glm::vec3((*transform)[3]) + c;
 	}
 
+	if (sm_singleton->isCulled(c, sqrtf(glm::dot(vX, vX) + glm::dot(vY, vY) + glm::dot(vZ, vZ))))
+		return;
+
 	// top verts
 	vVerts[0] = c - vX - vZ - vY;
 	vVerts[1] = c - vX + vZ - vY;
@@ -220,20 +2158,9 @@ void Gizmos::addAABB(const glm::vec3& center,
 	vVerts[6] = c + vX + vZ + vY;
 	vVerts[7] = c + vX - vZ + vY;
 
-	addLine(vVerts[0], vVerts[1], colour, colour);
-	addLine(vVerts[1], vVerts[2], colour, colour);
-	addLine(vVerts[2], vVerts[3], colour, colour);
-	addLine(vVerts[3], vVerts[0], colour, colour);
-
-	addLine(vVerts[4], vVerts[5], colour, colour);
-	addLine(vVerts[5], vVerts[6], colour, colour);
-	addLine(vVerts[6], vVerts[7], colour, colour);
-	addLine(vVerts[7], vVerts[4], colour, colour);
-
-	addLine(vVerts[0], vVerts[4], colour, colour);
-	addLine(vVerts[1], vVerts[5], colour, colour);
-	addLine(vVerts[2], vVerts[6], colour, colour);
-	addLine(vVerts[3], vVerts[7], colour, colour);
+	Layer* layer = sm_singleton->getLayer();
+	unsigned int base = sm_singleton->addVertices(layer->lines, vVerts, 8, colour);
+	sm_singleton->addIndices(layer->lines, sm_boxLineIndices, 24, base);
 }
 
 void Gizmos::addAABBFilled(const glm::vec3& center, 
@@ -241,6 +2168,9 @@ void Gizmos::addAABBFilled(const glm::vec3& center,
 	const glm::vec4& fillColour, 
 	const glm::mat4* transform) {
 
+	if (isChannelActive() == false)
+		return;
+
 	glm::vec3 vVerts[8];
 	glm::vec3 tempCenter = center;
 	glm::vec3 vX(rvExtents.x, 0, 0);
@@ -254,6 +2184,9 @@ void Gizmos::addAABBFilled(const glm::vec3& center,
 		tempCenter = glm::vec3((*transform)[3]) + tempCenter;
 	}
 
+	if (sm_singleton->isCulled(tempCenter, sqrtf(glm::dot(vX, vX) + glm::dot(vY, vY) + glm::dot(vZ, vZ))))
+		return;
+
 	// top verts
 	vVerts[0] = tempCenter - vX - vZ - vY;
 	vVerts[1] = tempCenter - vX + vZ - vY;
@@ -268,195 +2201,149 @@ void Gizmos::addAABBFilled(const glm::vec3& center,
 
 	glm::vec4 vWhite(1,1,1,1);
 
-	addLine(vVerts[0], vVerts[1], vWhite, vWhite);
-	addLine(vVerts[1], vVerts[2], vWhite, vWhite);
-	addLine(vVerts[2], vVerts[3], vWhite, vWhite);
-	addLine(vVerts[3], vVerts[0], vWhite, vWhite);
-
-	addLine(vVerts[4], vVerts[5], vWhite, vWhite);
-	addLine(vVerts[5], vVerts[6], vWhite, vWhite);
-	addLine(vVerts[6], vVerts[7], vWhite, vWhite);
-	addLine(vVerts[7], vVerts[4], vWhite, vWhite);
-
-	addLine(vVerts[0], vVerts[4], vWhite, vWhite);
-	addLine(vVerts[1], vVerts[5], vWhite, vWhite);
-	addLine(vVerts[2], vVerts[6], vWhite, vWhite);
-	addLine(vVerts[3], vVerts[7], vWhite, vWhite);
-
-	// top
-	addTri(vVerts[2], vVerts[1], vVerts[0], fillColour);
-	addTri(vVerts[3], vVerts[2], vVerts[0], fillColour);
-
-	// bottom
-	addTri(vVerts[5], vVerts[6], vVerts[4], fillColour);
-	addTri(vVerts[6], vVerts[7], vVerts[4], fillColour);
+	Layer* layer = sm_singleton->getLayer();
+	unsigned int base = sm_singleton->addVertices(layer->lines, vVerts, 8, vWhite);
+	sm_singleton->addIndices(layer->lines, sm_boxLineIndices, 24, base);
 
-	// front
-	addTri(vVerts[4], vVerts[3], vVerts[0], fillColour);
-	addTri(vVerts[7], vVerts[3], vVerts[4], fillColour);
-
-	// back
-	addTri(vVerts[1], vVerts[2], vVerts[5], fillColour);
-	addTri(vVerts[2], vVerts[6], vVerts[5], fillColour);
-
-	// left
-	addTri(vVerts[0], vVerts[1], vVerts[4], fillColour);
-	addTri(vVerts[1], vVerts[5], vVerts[4], fillColour);
-
-	// right
-	addTri(vVerts[2], vVerts[3], vVerts[7], fillColour);
-	addTri(vVerts[6], vVerts[2], vVerts[7], fillColour);
+	GizmoBuffer& tris = fillColour.w == 1 ? layer->tris : layer->transparentTris;
+	base = sm_singleton->addVertices(tris, vVerts, 8, fillColour);
+	sm_singleton->addIndices(tris, sm_boxTriIndices, 36, base);
 }
 
 void Gizmos::addCylinderFilled(const glm::vec3& center, float radius, float fHalfLength,
 	unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform) {
 
+	if (isChannelActive() == false || segments == 0)
+		return;
+
 	glm::vec4 white(1,1,1,1);
 
 	glm::vec3 tempCenter = transform != nullptr ? glm::vec3((*transform)[3]) + center : center;
 
-	float segmentSize = (2 * glm::pi<float>()) / segments;
-
-	for ( unsigned int i = 0 ; i < segments ; ++i ) {
-		glm::vec3 v0top(0,fHalfLength,0);
-		glm::vec3 v1top( sinf( i * segmentSize ) * radius, fHalfLength, cosf( i * segmentSize ) * radius);
-		glm::vec3 v2top( sinf( (i+1) * segmentSize ) * radius, fHalfLength, cosf( (i+1) * segmentSize ) * radius);
-		glm::vec3 v0bottom(0,-fHalfLength,0);
-		glm::vec3 v1bottom( sinf( i * segmentSize ) * radius, -fHalfLength, cosf( i * segmentSize ) * radius);
-		glm::vec3 v2bottom( sinf( (i+1) * segmentSize ) * radius, -fHalfLength, cosf( (i+1) * segmentSize ) * radius);
-
-		if (transform != nullptr) {
-			v0top = glm::vec3((*transform * glm::vec4(v0top, 0)));
-			v1top = glm::vec3((*transform * glm::vec4(v1top, 0)));
-			v2top = glm::vec3((*transform * glm::vec4(v2top, 0)));
-			v0bottom = glm::vec3((*transform * glm::vec4(v0bottom, 0)));
-			v1bottom = glm::vec3((*transform * glm::vec4(v1bottom, 0)));
-			v2bottom = glm::vec3((*transform * glm::vec4(v2bottom, 0)));
-		}
+	if (sm_singleton->isCulled(tempCenter, sqrtf(radius * radius + fHalfLength * fHalfLength)))
+		return;
+	segments = sm_singleton->getSegments(tempCenter, radius, segments);
 
-		// triangles
-		addTri(tempCenter + v0top, tempCenter + v1top, tempCenter + v2top, fillColour);
-		addTri(tempCenter + v0bottom, tempCenter + v2bottom, tempCenter + v1bottom, fillColour);
-		addTri(tempCenter + v2top, tempCenter + v1top, tempCenter + v1bottom, fillColour);
-		addTri(tempCenter + v1bottom, tempCenter + v2bottom, tempCenter + v2top, fillColour);
+	glm::mat4 m = shapeTransform(tempCenter, transform, glm::vec3(radius, fHalfLength, radius));
 
-		// lines
-		addLine(tempCenter + v1top, tempCenter + v2top, white, white);
-		addLine(tempCenter + v1top, tempCenter + v1bottom, white, white);
-		addLine(tempCenter + v1bottom, tempCenter + v2bottom, white, white);
-	}
+	Layer* layer = sm_singleton->getLayer();
+	MeshInstances* mesh = sm_singleton->getInstances(layer, CYLINDER, 0, segments);
+	sm_singleton->addInstance(*layer, fillColour.w == 1 ? mesh->tris : mesh->transparentTris, m, fillColour);
+	sm_singleton->addInstance(*layer, mesh->lines, m, white);
 }
 
 void Gizmos::addRing(const glm::vec3& center, float innerRadius, float outerRadius,
 	unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform) {
 
+	if (isChannelActive() == false || segments == 0)
+		return;
+
 	glm::vec4 vSolid = fillColour;
 	vSolid.w = 1;
 
 	glm::vec3 tempCenter = transform != nullptr ? glm::vec3((*transform)[3]) + center : center;
 
-	float fSegmentSize = (2 * glm::pi<float>()) / segments;
-
-	for ( unsigned int i = 0 ; i < segments ; ++i ) {
-		glm::vec3 v1outer( sinf( i * fSegmentSize ) * outerRadius, 0, cosf( i * fSegmentSize ) * outerRadius );
-		glm::vec3 v2outer( sinf( (i+1) * fSegmentSize ) * outerRadius, 0, cosf( (i+1) * fSegmentSize ) * outerRadius );
-		glm::vec3 v1inner( sinf( i * fSegmentSize ) * innerRadius, 0, cosf( i * fSegmentSize ) * innerRadius );
-		glm::vec3 v2inner( sinf( (i+1) * fSegmentSize ) * innerRadius, 0, cosf( (i+1) * fSegmentSize ) * innerRadius );
-
-		if (transform != nullptr) {
-			v1outer = glm::vec3((*transform * glm::vec4(v1outer, 0)));
-			v2outer = glm::vec3((*transform * glm::vec4(v2outer, 0)));
-			v1inner = glm::vec3((*transform * glm::vec4(v1inner, 0)));
-			v2inner = glm::vec3((*transform * glm::vec4(v2inner, 0)));
-		}
+	if (sm_singleton->isCulled(tempCenter, outerRadius))
+		return;
+	segments = sm_singleton->getSegments(tempCenter, outerRadius, segments);
 
-		if (fillColour.w != 0) {
-			addTri(tempCenter + v2outer, tempCenter + v1outer, tempCenter + v1inner, fillColour);
-			addTri(tempCenter + v1inner, tempCenter + v2inner, tempCenter + v2outer, fillColour);
+	glm::mat4 m = shapeTransform(tempCenter, transform, glm::vec3(outerRadius));
+	float innerRatio = outerRadius != 0 ? innerRadius / outerRadius : 0;
 
-			addTri(tempCenter + v1inner, tempCenter + v1outer, tempCenter + v2outer, fillColour);
-			addTri(tempCenter + v2outer, tempCenter + v2inner, tempCenter + v1inner, fillColour);
-		}
-		else {
-			// line
-			addLine(tempCenter + v1inner, tempCenter + v2inner, vSolid, vSolid);
-			addLine(tempCenter + v1outer, tempCenter + v2outer, vSolid, vSolid);
-		}
-	}
+	Layer* layer = sm_singleton->getLayer();
+	MeshInstances* mesh = sm_singleton->getInstances(layer, RING, 0, segments);
+	if (fillColour.w != 0)
+		sm_singleton->addInstance(*layer, fillColour.w == 1 ? mesh->tris : mesh->transparentTris, m, fillColour, innerRatio);
+	else
+		sm_singleton->addInstance(*layer, mesh->lines, m, vSolid, innerRatio);
 }
 
 void Gizmos::addDisk(const glm::vec3& center, float radius,
 	unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform) {
 
+	if (isChannelActive() == false || segments == 0)
+		return;
+
 	glm::vec4 vSolid = fillColour;
 	vSolid.w = 1;
 
 	glm::vec3 tempCenter = transform != nullptr ? glm::vec3((*transform)[3]) + center : center;
 
-	float fSegmentSize = (2 * glm::pi<float>()) / segments;
-
-	for ( unsigned int i = 0 ; i < segments ; ++i ) {
-		glm::vec3 v1outer( sinf( i * fSegmentSize ) * radius, 0, cosf( i * fSegmentSize ) * radius );
-		glm::vec3 v2outer( sinf( (i+1) * fSegmentSize ) * radius, 0, cosf( (i+1) * fSegmentSize ) * radius );
+	if (sm_singleton->isCulled(tempCenter, radius))
+		return;
+	segments = sm_singleton->getSegments(tempCenter, radius, segments);
 
-		if (transform != nullptr) {
-			v1outer = glm::vec3((*transform * glm::vec4(v1outer, 0)));
-			v2outer = glm::vec3((*transform * glm::vec4(v2outer, 0)));
-		}
+	glm::mat4 m = shapeTransform(tempCenter, transform, glm::vec3(radius));
 
-		if (fillColour.w != 0) {
-			addTri(tempCenter, tempCenter + v1outer, tempCenter + v2outer, fillColour);
-			addTri(tempCenter + v2outer, tempCenter + v1outer, tempCenter, fillColour);
-		}
-		else {
-			// line
-			addLine(tempCenter + v1outer, tempCenter + v2outer, vSolid, vSolid);
-		}
-	}
+	Layer* layer = sm_singleton->getLayer();
+	MeshInstances* mesh = sm_singleton->getInstances(layer, DISK, 0, segments);
+	if (fillColour.w != 0)
+		sm_singleton->addInstance(*layer, fillColour.w == 1 ? mesh->tris : mesh->transparentTris, m, fillColour);
+	else
+		sm_singleton->addInstance(*layer, mesh->lines, m, vSolid);
 }
 
 void Gizmos::addArc(const glm::vec3& center, float rotation,
 	float radius, float arcHalfAngle,
 	unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform) {
 
+	if (isChannelActive() == false || segments == 0)
+		return;
+
 	glm::vec4 vSolid = fillColour;
 	vSolid.w = 1;
 
 	glm::vec3 tempCenter = transform != nullptr ? glm::vec3((*transform)[3]) + center : center;
 
+	if (sm_singleton->isCulled(tempCenter, radius))
+		return;
+	segments = sm_singleton->getSegments(tempCenter, radius, segments, 2 * arcHalfAngle);
+
+	if (sm_singleton->m_computeTessellation) {
+		unsigned int flags = fillColour.w == 0 ? SHAPE_BORDER_LINES :
+							 SHAPE_FILLED | SHAPE_DOUBLE_SIDED | (fillColour.w == 1 ? 0u : (unsigned int)SHAPE_TRANSPARENT);
+		sm_singleton->addComputeShape(RING_PATCH, shapeTransform(tempCenter, transform, glm::vec3(1)),
+									  rotation - arcHalfAngle, rotation + arcHalfAngle, 0, radius, 1, segments,
+									  flags, fillColour, vSolid, tempCenter, radius);
+		return;
+	}
+
 	float fSegmentSize = (2 * arcHalfAngle) / segments;
 
-	for ( unsigned int i = 0 ; i < segments ; ++i ) {
-		glm::vec3 v1outer( sinf( i * fSegmentSize - arcHalfAngle + rotation ) * radius, 0, cosf( i * fSegmentSize - arcHalfAngle + rotation ) * radius);
-		glm::vec3 v2outer( sinf( (i+1) * fSegmentSize - arcHalfAngle + rotation ) * radius, 0, cosf( (i+1) * fSegmentSize - arcHalfAngle + rotation ) * radius);
+	// centre then the edge, which doesn't wrap
+	Layer* layer = sm_singleton->getLayer();
+	GizmoBuffer& buffer = fillColour.w == 0 ? layer->lines :
+						  fillColour.w == 1 ? layer->tris : layer->transparentTris;
+	glm::vec4 colour = fillColour.w != 0 ? fillColour : vSolid;
 
-		if (transform != nullptr) {
-			v1outer = glm::vec3((*transform * glm::vec4(v1outer, 0)));
-			v2outer = glm::vec3((*transform * glm::vec4(v2outer, 0)));
-		}
+	unsigned int base = sm_singleton->addVertex(buffer, tempCenter.x, tempCenter.y, tempCenter.z, colour);
+
+	for ( unsigned int i = 0 ; i <= segments ; ++i ) {
+		glm::vec3 v( sinf( i * fSegmentSize - arcHalfAngle + rotation ) * radius, 0, cosf( i * fSegmentSize - arcHalfAngle + rotation ) * radius);
 
+		if (transform != nullptr)
+			v = glm::vec3((*transform * glm::vec4(v, 0)));
+
+		v += tempCenter;
+		sm_singleton->addVertex(buffer, v.x, v.y, v.z, colour);
+	}
+
+	for ( unsigned int i = 0 ; i < segments ; ++i ) {
 		if (fillColour.w != 0) {
-			addTri(tempCenter, tempCenter + v1outer, tempCenter + v2outer, fillColour);
-			addTri(tempCenter + v2outer, tempCenter + v1outer, tempCenter, fillColour);
+			unsigned int tris[] = { 0, i + 1, i + 2,  i + 2, i + 1, 0 };
+			sm_singleton->addIndices(buffer, tris, 6, base);
 		}
 		else {
 			// line
-			addLine(tempCenter + v1outer, tempCenter + v2outer, vSolid, vSolid);
+			unsigned int lines[] = { i + 1, i + 2 };
+			sm_singleton->addIndices(buffer, lines, 2, base);
 		}
 	}
 
 	// edge lines
 	if (fillColour.w == 0) {
-		glm::vec3 v1outer( sinf( -arcHalfAngle + rotation ) * radius, 0, cosf( -arcHalfAngle + rotation ) * radius );
-		glm::vec3 v2outer( sinf( arcHalfAngle + rotation ) * radius, 0, cosf( arcHalfAngle + rotation ) * radius );
-
-		if (transform != nullptr) {
-			v1outer = glm::vec3((*transform * glm::vec4(v1outer, 0)));
-			v2outer = glm::vec3((*transform * glm::vec4(v2outer, 0)));
-		}
-
-		addLine(tempCenter, tempCenter + v1outer, vSolid, vSolid);
-		addLine(tempCenter, tempCenter + v2outer, vSolid, vSolid);
+		unsigned int lines[] = { 0, 1,  0, segments + 1 };
+		sm_singleton->addIndices(buffer, lines, 4, base);
 	}
 }
 
@@ -464,56 +2351,73 @@ void Gizmos::addArcRing(const glm::vec3& center, float rotation,
 	float innerRadius, float outerRadius, float arcHalfAngle,
 	unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform) {
 
+	if (isChannelActive() == false || segments == 0)
+		return;
+
 	glm::vec4 vSolid = fillColour;
 	vSolid.w = 1;
 
 	glm::vec3 tempCenter = transform != nullptr ? glm::vec3((*transform)[3]) + center : center;
 
+	if (sm_singleton->isCulled(tempCenter, outerRadius))
+		return;
+	segments = sm_singleton->getSegments(tempCenter, outerRadius, segments, 2 * arcHalfAngle);
+
+	if (sm_singleton->m_computeTessellation) {
+		unsigned int flags = fillColour.w == 0 ? SHAPE_BORDER_LINES :
+							 SHAPE_FILLED | SHAPE_DOUBLE_SIDED | (fillColour.w == 1 ? 0u : (unsigned int)SHAPE_TRANSPARENT);
+		sm_singleton->addComputeShape(RING_PATCH, shapeTransform(tempCenter, transform, glm::vec3(1)),
+									  rotation - arcHalfAngle, rotation + arcHalfAngle, innerRadius, outerRadius, 1, segments,
+									  flags, fillColour, vSolid, tempCenter, outerRadius);
+		return;
+	}
+
 	float fSegmentSize = (2 * arcHalfAngle) / segments;
 
-	for ( unsigned int i = 0 ; i < segments ; ++i ) {
-		glm::vec3 v1outer( sinf( i * fSegmentSize - arcHalfAngle + rotation ) * outerRadius, 0, cosf( i * fSegmentSize - arcHalfAngle + rotation ) * outerRadius );
-		glm::vec3 v2outer( sinf( (i+1) * fSegmentSize - arcHalfAngle + rotation ) * outerRadius, 0, cosf( (i+1) * fSegmentSize - arcHalfAngle + rotation ) * outerRadius );
-		glm::vec3 v1inner( sinf( i * fSegmentSize - arcHalfAngle + rotation  ) * innerRadius, 0, cosf( i * fSegmentSize - arcHalfAngle + rotation  ) * innerRadius );
-		glm::vec3 v2inner( sinf( (i+1) * fSegmentSize - arcHalfAngle + rotation  ) * innerRadius, 0, cosf( (i+1) * fSegmentSize - arcHalfAngle + rotation  ) * innerRadius );
+	// outer and inner edge pairs, which don't wrap
+	Layer* layer = sm_singleton->getLayer();
+	GizmoBuffer& buffer = fillColour.w == 0 ? layer->lines :
+						  fillColour.w == 1 ? layer->tris : layer->transparentTris;
+	glm::vec4 colour = fillColour.w != 0 ? fillColour : vSolid;
+
+	unsigned int base = buffer.vertices.count;
+
+	for ( unsigned int i = 0 ; i <= segments ; ++i ) {
+		glm::vec3 vOuter( sinf( i * fSegmentSize - arcHalfAngle + rotation ) * outerRadius, 0, cosf( i * fSegmentSize - arcHalfAngle + rotation ) * outerRadius );
+		glm::vec3 vInner( sinf( i * fSegmentSize - arcHalfAngle + rotation  ) * innerRadius, 0, cosf( i * fSegmentSize - arcHalfAngle + rotation  ) * innerRadius );
 
 		if (transform != nullptr) {
-			v1outer = glm::vec3((*transform * glm::vec4(v1outer, 0)));
-			v2outer = glm::vec3((*transform * glm::vec4(v2outer, 0)));
-			v1inner = glm::vec3((*transform * glm::vec4(v1inner, 0)));
-			v2inner = glm::vec3((*transform * glm::vec4(v2inner, 0)));
+			vOuter = glm::vec3((*transform * glm::vec4(vOuter, 0)));
+			vInner = glm::vec3((*transform * glm::vec4(vInner, 0)));
 		}
 
-		if (fillColour.w != 0) {
-			addTri(tempCenter + v2outer, tempCenter + v1outer, tempCenter + v1inner, fillColour);
-			addTri(tempCenter + v1inner, tempCenter + v2inner, tempCenter + v2outer, fillColour);
+		vOuter += tempCenter;
+		vInner += tempCenter;
+		sm_singleton->addVertex(buffer, vOuter.x, vOuter.y, vOuter.z, colour);
+		sm_singleton->addVertex(buffer, vInner.x, vInner.y, vInner.z, colour);
+	}
 
-			addTri(tempCenter + v1inner, tempCenter + v1outer, tempCenter + v2outer, fillColour);
-			addTri(tempCenter + v2outer, tempCenter + v2inner, tempCenter + v1inner, fillColour);
+	for ( unsigned int i = 0 ; i < segments ; ++i ) {
+		unsigned int o1 = i * 2;
+		unsigned int i1 = o1 + 1;
+		unsigned int o2 = o1 + 2;
+		unsigned int i2 = o1 + 3;
+
+		if (fillColour.w != 0) {
+			unsigned int tris[] = { o2, o1, i1,  i1, i2, o2,  i1, o1, o2,  o2, i2, i1 };
+			sm_singleton->addIndices(buffer, tris, 12, base);
 		}
 		else {
 			// line
-			addLine(tempCenter + v1inner, tempCenter + v2inner, vSolid, vSolid);
-			addLine(tempCenter + v1outer, tempCenter + v2outer, vSolid, vSolid);
+			unsigned int lines[] = { i1, i2,  o1, o2 };
+			sm_singleton->addIndices(buffer, lines, 4, base);
 		}
 	}
 
 	// edge lines
 	if (fillColour.w == 0) {
-		glm::vec3 v1outer( sinf( -arcHalfAngle + rotation ) * outerRadius, 0, cosf( -arcHalfAngle + rotation ) * outerRadius );
-		glm::vec3 v2outer( sinf( arcHalfAngle + rotation ) * outerRadius, 0, cosf( arcHalfAngle + rotation ) * outerRadius );
-		glm::vec3 v1inner( sinf( -arcHalfAngle + rotation  ) * innerRadius, 0, cosf( -arcHalfAngle + rotation  ) * innerRadius );
-		glm::vec3 v2inner( sinf( arcHalfAngle + rotation  ) * innerRadius, 0, cosf( arcHalfAngle + rotation  ) * innerRadius );
-
-		if (transform != nullptr) {
-			v1outer = glm::vec3((*transform * glm::vec4(v1outer, 0)));
-			v2outer = glm::vec3((*transform * glm::vec4(v2outer, 0)));
-			v1inner = glm::vec3((*transform * glm::vec4(v1inner, 0)));
-			v2inner = glm::vec3((*transform * glm::vec4(v2inner, 0)));
-		}
-
-		addLine(tempCenter + v1inner, tempCenter + v1outer, vSolid, vSolid);
-		addLine(tempCenter + v2inner, tempCenter + v2outer, vSolid, vSolid);
+		unsigned int lines[] = { 1, 0,  segments * 2 + 1, segments * 2 };
+		sm_singleton->addIndices(buffer, lines, 4, base);
 	}
 }
 
@@ -521,6 +2425,49 @@ void Gizmos::addSphere(const glm::vec3& center, float radius, int rows, int colu
 								const glm::mat4* transform, float longMin, float longMax, 
 								float latMin, float latMax) {
 
+	if (isChannelActive() == false || rows <= 0 || columns <= 0)
+		return;
+
+	// whole spheres are drawn from a cached unit mesh
+	if (longMin == 0 && longMax == 360 && latMin == -90 && latMax == 90) {
+		glm::vec3 tempCenter = transform != nullptr ? glm::vec3((*transform)[3]) + center : center;
+
+		if (sm_singleton->isCulled(tempCenter, radius))
+			return;
+
+		// rows drop with the columns to keep the faces' shape
+		int lodColumns = sm_singleton->getSegments(tempCenter, radius, columns);
+		rows = glm::max(2, rows * lodColumns / columns);
+		columns = lodColumns;
+
+		glm::mat4 m = shapeTransform(tempCenter, transform, glm::vec3(radius));
+
+		Layer* layer = sm_singleton->getLayer();
+		MeshInstances* mesh = sm_singleton->getInstances(layer, SPHERE, rows, columns);
+		sm_singleton->addInstance(*layer, fillColour.w == 1 ? mesh->tris : mesh->transparentTris, m, fillColour);
+		sm_singleton->addInstance(*layer, mesh->lines, m, glm::vec4(1));
+		return;
+	}
+
+	glm::vec3 tempCenter = transform != nullptr ? glm::vec3((*transform)[3]) + center : center;
+
+	if (sm_singleton->isCulled(tempCenter, radius))
+		return;
+
+	float longitudinalAngle = (longMax - longMin) * glm::pi<float>() / 180;
+	int lodColumns = sm_singleton->getSegments(tempCenter, radius, columns, longitudinalAngle);
+	rows = glm::max(1, rows * lodColumns / columns);
+	columns = lodColumns;
+
+	if (sm_singleton->m_computeTessellation) {
+		float DEG2RAD = glm::pi<float>() / 180;
+		unsigned int flags = SHAPE_FILLED | SHAPE_GRID_LINES | (fillColour.w == 1 ? 0u : (unsigned int)SHAPE_TRANSPARENT);
+		sm_singleton->addComputeShape(SPHERE_PATCH, shapeTransform(tempCenter, transform, glm::vec3(radius)),
+									  longMin * DEG2RAD, longMax * DEG2RAD, latMin * DEG2RAD, latMax * DEG2RAD,
+									  rows, columns, flags, fillColour, glm::vec4(1), tempCenter, radius);
+		return;
+	}
+
 	float inverseRadius = 1 / radius;
 
 	// invert these first as the multiply is slightly quicker
@@ -529,8 +2476,6 @@ void Gizmos::addSphere(const glm::vec3& center, float radius, int rows, int colu
 
 	float DEG2RAD = glm::pi<float>() / 180;
 
-	glm::vec3 tempCenter = transform != nullptr ? glm::vec3((*transform)[3]) + center : center;
-	
 	//Lets put everything in radians first
 	float latitiudinalRange = (latMax - latMin) * DEG2RAD;
 	float longitudinalRange = (longMax - longMin) * DEG2RAD;
@@ -561,20 +2506,33 @@ void Gizmos::addSphere(const glm::vec3& center, float radius, int rows, int colu
 		}
 	}
 	
+	// points are shared between the faces and outline
+	for (int i = 0; i < rows * columns + columns; ++i)
+		v4Array[i] += tempCenter;
+
+	Layer* layer = sm_singleton->getLayer();
+	GizmoBuffer& tris = fillColour.w == 1 ? layer->tris : layer->transparentTris;
+	unsigned int lineBase = sm_singleton->addVertices(layer->lines, v4Array, rows * columns + columns, glm::vec4(1));
+	unsigned int triBase = sm_singleton->addVertices(tris, v4Array, rows * columns + columns, fillColour);
+	
 	for (int face = 0; face < (rows)*(columns); ++face ) {
-		int iNextFace = face + 1;		
+		unsigned int iNextFace = face + 1;		
 		
 		if( iNextFace % columns == 0 )
 			iNextFace = iNextFace - (columns);
 
-		addLine(tempCenter + v4Array[face], tempCenter + v4Array[face+columns], glm::vec4(1.f,1.f,1.f,1.f), glm::vec4(1.f,1.f,1.f,1.f));
+		unsigned int edge[] = { (unsigned int)face, (unsigned int)face + columns };
+		sm_singleton->addIndices(layer->lines, edge, 2, lineBase);
 		
 		if( face % columns == 0 && longitudinalRange < (glm::pi<float>() * 2))
 			continue;
-		addLine(tempCenter + v4Array[iNextFace+columns], tempCenter + v4Array[face+columns], glm::vec4(1.f,1.f,1.f,1.f), glm::vec4(1.f,1.f,1.f,1.f));
 
-		addTri(tempCenter + v4Array[iNextFace+columns], tempCenter + v4Array[face], tempCenter + v4Array[iNextFace], fillColour);
-		addTri(tempCenter + v4Array[iNextFace+columns], tempCenter + v4Array[face+columns], tempCenter + v4Array[face], fillColour);
+		unsigned int lines[] = { iNextFace + columns, (unsigned int)face + columns };
+		sm_singleton->addIndices(layer->lines, lines, 2, lineBase);
+
+		unsigned int faces[] = { iNextFace + columns, (unsigned int)face, iNextFace,
+								 iNextFace + columns, (unsigned int)face + columns, (unsigned int)face };
+		sm_singleton->addIndices(tris, faces, 6, triBase);
 	}
 
 	delete[] v4Array;	
@@ -583,225 +2541,430 @@ void Gizmos::addSphere(const glm::vec3& center, float radius, int rows, int colu
 void Gizmos::addCapsule(const glm::vec3& center, float height, float radius,
 						int rows, int cols, const glm::vec4& fillColour, const glm::mat4* rotation) {
 
-	float sphereCenters = (height * 0.5f) - radius;
-	glm::vec4 top = glm::vec4(0, sphereCenters, 0, 0);
-	glm::vec4 bottom = glm::vec4(0, -sphereCenters, 0, 0);
+	if (isChannelActive() == false || rows <= 0 || cols <= 0 || radius == 0)
+		return;
+
 	glm::vec4 white(1);
 
-	if (rotation) {
-		top = (*rotation) * top + (*rotation)[3];
-		bottom = (*rotation) * bottom + (*rotation)[3];
-	}
+	glm::vec3 tempCenter = rotation != nullptr ? glm::vec3((*rotation)[3]) + center : center;
 
-	glm::vec3 topCenter = center + glm::vec3(top);
-	glm::vec3 bottomCenter = center + glm::vec3(bottom);
+	if (sm_singleton->isCulled(tempCenter, glm::max(height * 0.5f, radius)))
+		return;
 
-	float inverseRadius = 1 / radius;
+	// the mesh splits into halves at rows / 2, so reduced rows are rounded up to stay even
+	int lodCols = sm_singleton->getSegments(tempCenter, radius, cols);
+	rows = glm::max(2, rows * lodCols / cols);
+	if (lodCols < cols)
+		rows = (rows + 1) & ~1;
+	cols = lodCols;
 
-	// invert these first as the multiply is slightly quicker
-	float invColumns = 1.0f / float(cols);
-	float invRows = 1.0f / float(rows);
+	// the halves of the unit mesh are pushed apart by the distance between the sphere centres
+	float sphereCenters = (height * 0.5f) - radius;
 
-	float DEG2RAD = glm::pi<float>() / 180;
-	float latMin = -90, latMax = 90, longMin = 0.f, longMax = 360;
+	glm::mat4 m = shapeTransform(tempCenter, rotation, glm::vec3(radius));
 
-	// lets put everything in radians first
-	float latitiudinalRange = (latMax - latMin) * DEG2RAD;
-	float longitudinalRange = (longMax - longMin) * DEG2RAD;
+	Layer* layer = sm_singleton->getLayer();
+	MeshInstances* mesh = sm_singleton->getInstances(layer, CAPSULE, rows, cols);
+	sm_singleton->addInstance(*layer, fillColour.w == 1 ? mesh->tris : mesh->transparentTris, m, fillColour, 0, sphereCenters / radius);
+	sm_singleton->addInstance(*layer, mesh->lines, m, white, 0, sphereCenters / radius);
+}
 
-	// for each row of the mesh
-	glm::vec3* v4Array = new glm::vec3[rows*cols + cols];
+void Gizmos::addHermiteSpline(const glm::vec3& start, const glm::vec3& end,
+	const glm::vec3& tangentStart, const glm::vec3& tangentEnd, unsigned int segments, const glm::vec4& colour) {
 
-	for (int row = 0; row <= (rows); ++row) {
-		// y ordinates this may be a little confusing but here we are navigating around the xAxis in GL
-		float ratioAroundXAxis = float(row) * invRows;
-		float radiansAboutXAxis = ratioAroundXAxis * latitiudinalRange + (latMin * DEG2RAD);
-		float y = radius * sin(radiansAboutXAxis);
-		float z = radius * cos(radiansAboutXAxis);
+	if (isChannelActive() == false)
+		return;
 
-		for (int col = 0; col <= cols; ++col) {
-			float ratioAroundYAxis = float(col) * invColumns;
-			float theta = ratioAroundYAxis * longitudinalRange + (longMin * DEG2RAD);
-			glm::vec3 v4Point(-z * sinf(theta), y, -z * cosf(theta));
-			glm::vec3 v4Normal(inverseRadius * v4Point.x, inverseRadius * v4Point.y, inverseRadius * v4Point.z);
+	// the same curve as a bezier, tessellated on the GPU
+	glm::vec3 points[] = { start, start + tangentStart / 3.0f, end - tangentEnd / 3.0f, end };
+	sm_singleton->addCurve(points, segments, colour);
+}
 
-			if (rotation != nullptr) {
-				v4Point = glm::vec3((*rotation * glm::vec4(v4Point, 0)));
-				v4Normal = glm::vec3((*rotation * glm::vec4(v4Normal, 0)));
-			}
+void Gizmos::addGrid(const glm::vec3& center, const glm::vec3& normal, float spacing, float extent,
+					 const glm::vec4& colour, const glm::vec4& axisColour) {
+
+	if (isChannelActive() == false || spacing <= 0)
+		return;
+
+	// any two axes on the plane will do
+	glm::vec3 n = glm::normalize(normal);
+	glm::vec3 u = fabsf(n.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+	u = glm::normalize(u - n * glm::dot(u, n));
+	glm::vec3 v = glm::cross(n, u);
+
+	Layer* layer = sm_singleton->getLayer();
+	layer->grids.push_back(GizmoGrid());
+	GizmoGrid& grid = layer->grids.back();
+
+	memcpy(grid.center, glm::value_ptr(center), sizeof(float) * 3);
+	memcpy(grid.axisU, glm::value_ptr(u), sizeof(float) * 3);
+	memcpy(grid.axisV, glm::value_ptr(v), sizeof(float) * 3);
+	grid.spacing = spacing;
+	grid.extent = extent;
+	memcpy(grid.colour, glm::value_ptr(colour), sizeof(float) * 4);
+	memcpy(grid.axisColour, glm::value_ptr(axisColour), sizeof(float) * 4);
+}
 
-			int index = row * cols + (col % cols);
-			v4Array[index] = v4Point;
-		}
+void Gizmos::drawText(const Layer& layer, const glm::mat4& projectionView) {
+	if (m_font == nullptr)
+		return;
+
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glUseProgram(m_textShader);
+	glUniformMatrix4fv(glGetUniformLocation(m_textShader, "ProjectionView"), 1, false, glm::value_ptr(projectionView));
+	glUniform2f(glGetUniformLocation(m_textShader, "ViewportSize"), (float)viewport[2], (float)viewport[3]);
+
+	// sample the font from whichever unit is active
+	int activeTexture = 0, texture = 0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+	glUniform1i(glGetUniformLocation(m_textShader, "Glyphs"), activeTexture - GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_font->getTextureHandle());
+
+	glBindVertexArray(m_textVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, layer.glyphVBO);
+
+	if (layer.glyphCount > 0) {
+		bindGlyphs(0);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, layer.glyphCount);
 	}
 
-	// create a sphere that is split in two
-	for (int face = 0; face < (rows)*(cols); ++face) {
-		int iNextFace = face + 1;
+	if (layer.overlayGlyphCount > 0) {
+		GLboolean depthEnabled = glIsEnabled(GL_DEPTH_TEST);
+		glDisable(GL_DEPTH_TEST);
 
-		if (iNextFace % cols == 0)
-			iNextFace = iNextFace - (cols);
+		bindGlyphs(layer.glyphCount);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, layer.overlayGlyphCount);
 
-		glm::vec3 tempCenter = topCenter;
-		if (face < (rows / 2)*cols)
-			tempCenter = bottomCenter;
+		if (depthEnabled == GL_TRUE)
+			glEnable(GL_DEPTH_TEST);
+	}
 
-		addLine(tempCenter + v4Array[face], tempCenter + v4Array[face + cols], white, white);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glUseProgram(m_shader);
+}
 
-		if (face % cols == 0 && longitudinalRange < (glm::pi<float>() * 2))
-			continue;
+void Gizmos::bindGlyphs(unsigned int base) {
+	size_t offset = base * sizeof(GizmoGlyph);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GizmoGlyph), (void*)offset);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GizmoGlyph), (void*)(offset + 44));
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoGlyph), (void*)(offset + 12));
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoGlyph), (void*)(offset + 28));
+}
+
+void Gizmos::setFont(Font* font) {
+	if (sm_singleton != nullptr)
+		sm_singleton->m_font = font;
+}
+
+void Gizmos::addText3D(const glm::vec3& position, const char* text, const glm::vec4& colour,
+					   float maxDistance, bool depthTest) {
+	if (isChannelActive() == false ||
+		sm_singleton->m_font == nullptr ||
+		text == nullptr || *text == 0)
+		return;
+
+	// culled as a point, as labels are small on screen. like other culling, groups are left alone
+	Layer* layer = sm_singleton->getLayer();
+	if (sm_singleton->isCulled(position, 0))
+		return;
+	if (maxDistance > 0 &&
+		sm_singleton->m_hasCamera &&
+		layer->building == false &&
+		glm::distance(position, glm::make_vec3(sm_singleton->m_cameraPosition)) > maxDistance)
+		return;
+
+	Font* font = sm_singleton->m_font;
+	stbtt_bakedchar* glyphData = (stbtt_bakedchar*)font->m_glyphData;
+	if (glyphData == nullptr)
+		return;
+
+	std::vector<GizmoGlyph>& glyphs = depthTest ? layer->glyphs : layer->overlayGlyphs;
+	size_t first = glyphs.size();
+
+	// the glyphs' y goes down the screen, so is flipped
+	stbtt_aligned_quad Q = {};
+	float xPos = 0.0f;
+	float yPos = 0.0f;
+	for (const char* c = text; *c != 0; ++c) {
+		stbtt_GetBakedQuad(glyphData, font->m_textureWidth, font->m_textureHeight, (unsigned char)*c, &xPos, &yPos, &Q, 1);
+
+		glyphs.push_back(GizmoGlyph());
+		GizmoGlyph& glyph = glyphs.back();
+		memcpy(glyph.position, glm::value_ptr(position), sizeof(float) * 3);
+		glyph.offset[0] = Q.x0;
+		glyph.offset[1] = -Q.y1;
+		glyph.offset[2] = Q.x1;
+		glyph.offset[3] = -Q.y0;
+		glyph.texCoords[0] = Q.s0;
+		glyph.texCoords[1] = Q.t1;
+		glyph.texCoords[2] = Q.s1;
+		glyph.texCoords[3] = Q.t0;
+		glyph.r = toByte(colour.r);
+		glyph.g = toByte(colour.g);
+		glyph.b = toByte(colour.b);
+		glyph.a = toByte(colour.a);
+	}
 
-		addLine(tempCenter + v4Array[iNextFace + cols], tempCenter + v4Array[face + cols], white, white);
-		addTri(tempCenter + v4Array[iNextFace + cols], tempCenter + v4Array[face], tempCenter + v4Array[iNextFace], fillColour);
-		addTri(tempCenter + v4Array[iNextFace + cols], tempCenter + v4Array[face + cols], tempCenter + v4Array[face], fillColour);
+	// centred on the advance width once it's known, as Font measures text
+	float halfWidth = xPos * 0.5f;
+	for (size_t i = first; i < glyphs.size(); ++i) {
+		glyphs[i].offset[0] -= halfWidth;
+		glyphs[i].offset[2] -= halfWidth;
 	}
+}
 
-	delete[] v4Array;
+void Gizmos::drawCurves(const Layer& layer, const glm::mat4& projectionView) {
 
-	for (int i = 0; i < cols; ++i) {
-		float x = (float)i / (float)cols;
-		float x1 = (float)(i+1) / (float)cols;
-		x *= 2.0f * glm::pi<float>();
-		x1 *= 2.0f * glm::pi<float>();
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
 
-		glm::vec3 pos = glm::vec3(cosf(x), 0, sinf(x)) * radius;
-		glm::vec3 pos1 = glm::vec3(cosf(x1), 0, sinf(x1)) * radius;
+	glUseProgram(m_curveShader);
+	glUniformMatrix4fv(glGetUniformLocation(m_curveShader, "ProjectionView"), 1, false, glm::value_ptr(projectionView));
+	glUniform2f(glGetUniformLocation(m_curveShader, "ViewportSize"), (float)viewport[2], (float)viewport[3]);
+	glUniform1f(glGetUniformLocation(m_curveShader, "Tolerance"), m_hasCamera ? m_tolerance : 0.5f);
 
-		if (rotation) {
-			pos = glm::vec3((*rotation) * glm::vec4(pos,0));
-			pos1 = glm::vec3((*rotation) * glm::vec4(pos1,0));
-		}
+	glBindVertexArray(m_curveVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, layer.curveVBO);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GizmoCurve), (void*)48);
+	for (unsigned int i = 0; i < 4; ++i)
+		glVertexAttribPointer(2 + i, 3, GL_FLOAT, GL_FALSE, sizeof(GizmoCurve), (void*)(size_t)(i * 12));
+	glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(GizmoCurve), (void*)52);
+
+	glDrawArraysInstanced(GL_LINES, 0, layer.curveSegments * 2, layer.curveCount);
+
+	glUseProgram(m_shader);
+}
+
+void Gizmos::addCurve(const glm::vec3* points, unsigned int segments, const glm::vec4& colour) {
+
+	// the curve stays inside its control points
+	glm::vec3 min = glm::min(glm::min(points[0], points[1]), glm::min(points[2], points[3]));
+	glm::vec3 max = glm::max(glm::max(points[0], points[1]), glm::max(points[2], points[3]));
+	if (isCulled((min + max) * 0.5f, glm::distance(min, max) * 0.5f))
+		return;
+
+	segments = glm::clamp(segments, 1u, 256u);
 
-		addTri(topCenter + pos1, bottomCenter + pos1, bottomCenter + pos, fillColour);
-		addTri(topCenter + pos1, bottomCenter + pos, topCenter + pos, fillColour);
+	Layer* layer = getLayer();
+	layer->curves.push_back(GizmoCurve());
+	GizmoCurve& curve = layer->curves.back();
 
-		addLine(topCenter + pos, topCenter + pos1, white, white);
-		addLine(bottomCenter + pos, bottomCenter + pos1, white, white);
-		addLine(topCenter + pos, bottomCenter + pos, white, white);
+	memcpy(curve.points, points, sizeof(float) * 12);
+	curve.r = toByte(colour.r);
+	curve.g = toByte(colour.g);
+	curve.b = toByte(colour.b);
+	curve.a = toByte(colour.a);
+	curve.segments = (float)segments;
+
+	if (segments > layer->curveSegments)
+		layer->curveSegments = segments;
+}
+
+void Gizmos::addBezier(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3,
+					   unsigned int segments, const glm::vec4& colour) {
+	if (isChannelActive()) {
+		glm::vec3 points[] = { p0, p1, p2, p3 };
+		sm_singleton->addCurve(points, segments, colour);
 	}
 }
 
-void Gizmos::addHermiteSpline(const glm::vec3& start, const glm::vec3& end,
-	const glm::vec3& tangentStart, const glm::vec3& tangentEnd, unsigned int segments, const glm::vec4& colour) {
+void Gizmos::addCatmullRom(const glm::vec3* points, unsigned int count,
+						   unsigned int segments, const glm::vec4& colour) {
+	if (isChannelActive() == false || count < 2)
+		return;
 
-	segments = segments > 1 ? segments : 1;
+	// the ends repeat so the curve reaches the first and last points
+	for (unsigned int i = 0; i < count - 1; ++i) {
+		const glm::vec3& p0 = points[i > 0 ? i - 1 : 0];
+		const glm::vec3& p1 = points[i];
+		const glm::vec3& p2 = points[i + 1];
+		const glm::vec3& p3 = points[i + 2 < count ? i + 2 : count - 1];
 
-	glm::vec3 prev = start;
+		glm::vec3 bezier[] = { p1, p1 + (p2 - p0) / 6.0f, p2 - (p3 - p1) / 6.0f, p2 };
+		sm_singleton->addCurve(bezier, segments, colour);
+	}
+}
 
-	for ( unsigned int i = 1 ; i <= segments ; ++i ) {
-		float s = i / (float)segments;
+void Gizmos::addBSpline(const glm::vec3* points, unsigned int count,
+						unsigned int segments, const glm::vec4& colour) {
+	if (isChannelActive() == false || count < 4)
+		return;
 
-		float s2 = s * s;
-		float s3 = s2 * s;
-		float h1 = (2.0f * s3) - (3.0f * s2) + 1.0f;
-		float h2 = (-2.0f * s3) + (3.0f * s2);
-		float h3 =  s3- (2.0f * s2) + s;
-		float h4 = s3 - s2;
-		glm::vec3 p = (start * h1) + (end * h2) + (tangentStart * h3) + (tangentEnd * h4);
+	for (unsigned int i = 0; i < count - 3; ++i) {
+		const glm::vec3& p0 = points[i];
+		const glm::vec3& p1 = points[i + 1];
+		const glm::vec3& p2 = points[i + 2];
+		const glm::vec3& p3 = points[i + 3];
 
-		addLine(prev,p,colour,colour);
-		prev = p;
+		glm::vec3 bezier[] = { (p0 + p1 * 4.0f + p2) / 6.0f, (p1 * 2.0f + p2) / 3.0f,
+							   (p1 + p2 * 2.0f) / 3.0f, (p1 + p2 * 4.0f + p3) / 6.0f };
+		sm_singleton->addCurve(bezier, segments, colour);
 	}
 }
 
+void Gizmos::addSegment(const glm::vec3& start, const glm::vec3& end, const glm::vec4& colour,
+						float width, float dashLength, float headSize) {
+
+	if (isCulled((start + end) * 0.5f, glm::distance(start, end) * 0.5f))
+		return;
+
+	Layer* layer = getLayer();
+	layer->segments.push_back(GizmoSegment());
+	GizmoSegment& segment = layer->segments.back();
+
+	memcpy(segment.start, glm::value_ptr(start), sizeof(float) * 3);
+	memcpy(segment.end, glm::value_ptr(end), sizeof(float) * 3);
+	segment.r = toByte(colour.r);
+	segment.g = toByte(colour.g);
+	segment.b = toByte(colour.b);
+	segment.a = toByte(colour.a);
+	segment.width = width;
+	segment.dashLength = dashLength;
+	segment.headSize = headSize;
+}
+
+void Gizmos::addThickLine(const glm::vec3& start, const glm::vec3& end, const glm::vec4& colour, float width) {
+	if (isChannelActive())
+		sm_singleton->addSegment(start, end, colour, width, 0, 0);
+}
+
+void Gizmos::addDashedLine(const glm::vec3& start, const glm::vec3& end, const glm::vec4& colour, float width, float dashLength) {
+	if (isChannelActive())
+		sm_singleton->addSegment(start, end, colour, width, dashLength, 0);
+}
+
+void Gizmos::addArrow(const glm::vec3& start, const glm::vec3& end, const glm::vec4& colour, float width, float headSize) {
+	if (isChannelActive())
+		sm_singleton->addSegment(start, end, colour, width, 0, headSize);
+}
+
 void Gizmos::addLine(const glm::vec3& v0,  const glm::vec3& v1, const glm::vec4& colour) {
 	addLine(v0,v1,colour,colour);
 }
 
 void Gizmos::addLine(const glm::vec3& v0, const glm::vec3& v1, const glm::vec4& colour0, const glm::vec4& colour1) {
 
-	if (sm_singleton != nullptr &&
-		sm_singleton->m_lineCount < sm_singleton->m_maxLines) {
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v0.x = v0.x;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v0.y = v0.y;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v0.z = v0.z;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v0.w = 1;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v0.r = colour0.r;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v0.g = colour0.g;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v0.b = colour0.b;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v0.a = colour0.a;
+	if (isChannelActive()) {
+		static const unsigned int indices[] = { 0, 1 };
 
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v1.x = v1.x;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v1.y = v1.y;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v1.z = v1.z;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v1.w = 1;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v1.r = colour1.r;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v1.g = colour1.g;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v1.b = colour1.b;
-		sm_singleton->m_lines[sm_singleton->m_lineCount].v1.a = colour1.a;
+		Layer* layer = sm_singleton->getLayer();
+		unsigned int base = sm_singleton->addVertex(layer->lines, v0.x, v0.y, v0.z, colour0);
+		sm_singleton->addVertex(layer->lines, v1.x, v1.y, v1.z, colour1);
+		sm_singleton->addIndices(layer->lines, indices, 2, base);
+	}
+}
+
+void Gizmos::addLine(const glm::vec3& v0, const glm::vec3& v1, const glm::vec4& colour, float duration) {
+	if (isChannelActive()) {
+		glm::vec3 positions[] = { v0, v1 };
+		sm_singleton->addTimed(sm_singleton->m_timedLines, positions, colour, duration);
+	}
+}
 
-		sm_singleton->m_lineCount++;
+void Gizmos::addTri(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const glm::vec4& colour, float duration) {
+	if (isChannelActive()) {
+		glm::vec3 positions[] = { v0, v1, v2 };
+		sm_singleton->addTimed(sm_singleton->m_timedTris, positions, colour, duration);
 	}
 }
 
 void Gizmos::addTri(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const glm::vec4& colour) {
-	if (sm_singleton != nullptr) {
-		if (colour.w == 1) {
-			if (sm_singleton->m_triCount < sm_singleton->m_maxTris) {
-				sm_singleton->m_tris[sm_singleton->m_triCount].v0.x = v0.x;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v0.y = v0.y;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v0.z = v0.z;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v0.w = 1;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v1.x = v1.x;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v1.y = v1.y;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v1.z = v1.z;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v1.w = 1;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v2.x = v2.x;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v2.y = v2.y;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v2.z = v2.z;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v2.w = 1;
-
-				sm_singleton->m_tris[sm_singleton->m_triCount].v0.r = colour.r;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v0.g = colour.g;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v0.b = colour.b;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v0.a = colour.a;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v1.r = colour.r;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v1.g = colour.g;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v1.b = colour.b;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v1.a = colour.a;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v2.r = colour.r;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v2.g = colour.g;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v2.b = colour.b;
-				sm_singleton->m_tris[sm_singleton->m_triCount].v2.a = colour.a;
-
-				sm_singleton->m_triCount++;
-			}
-		}
-		else {
-			if (sm_singleton->m_transparentTriCount < sm_singleton->m_maxTris) {
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v0.x = v0.x;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v0.y = v0.y;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v0.z = v0.z;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v0.w = 1;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v1.x = v1.x;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v1.y = v1.y;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v1.z = v1.z;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v1.w = 1;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v2.x = v2.x;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v2.y = v2.y;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v2.z = v2.z;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v2.w = 1;
-
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v0.r = colour.r;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v0.g = colour.g;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v0.b = colour.b;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v0.a = colour.a;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v1.r = colour.r;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v1.g = colour.g;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v1.b = colour.b;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v1.a = colour.a;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v2.r = colour.r;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v2.g = colour.g;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v2.b = colour.b;
-				sm_singleton->m_transparentTris[sm_singleton->m_transparentTriCount].v2.a = colour.a;
-
-				sm_singleton->m_transparentTriCount++;
-			}
-		}
+	if (isChannelActive()) {
+		static const unsigned int indices[] = { 0, 1, 2 };
+
+		Layer* layer = sm_singleton->getLayer();
+		GizmoBuffer& tris = colour.w == 1 ? layer->tris : layer->transparentTris;
+
+		unsigned int base = sm_singleton->addVertex(tris, v0.x, v0.y, v0.z, colour);
+		sm_singleton->addVertex(tris, v1.x, v1.y, v1.z, colour);
+		sm_singleton->addVertex(tris, v2.x, v2.y, v2.z, colour);
+		sm_singleton->addIndices(tris, indices, 3, base);
+	}
+}
+
+void Gizmos::addLines(const glm::vec3* positions, unsigned int count, const glm::vec4& colour, unsigned int stride) {
+	if (isChannelActive() == false || count == 0)
+		return;
+
+	Layer* layer = sm_singleton->getLayer();
+	unsigned int base = layer->lines.vertices.count;
+	sm_singleton->copyVertices(layer->lines.vertices, positions, stride, nullptr, 0, colour, count * 2);
+	sm_singleton->copyIndices(layer->lines.indices, base, count * 2);
+}
+
+void Gizmos::addLines(const glm::vec3* positions, const glm::vec4* colours, unsigned int count,
+					  unsigned int positionStride, unsigned int colourStride) {
+	if (isChannelActive() == false || count == 0)
+		return;
+
+	Layer* layer = sm_singleton->getLayer();
+	unsigned int base = layer->lines.vertices.count;
+	sm_singleton->copyVertices(layer->lines.vertices, positions, positionStride, colours, colourStride, glm::vec4(1), count * 2);
+	sm_singleton->copyIndices(layer->lines.indices, base, count * 2);
+}
+
+void Gizmos::addTris(const glm::vec3* positions, unsigned int count, const glm::vec4& colour, unsigned int stride) {
+	if (isChannelActive() == false || count == 0)
+		return;
+
+	Layer* layer = sm_singleton->getLayer();
+	GizmoBuffer& tris = colour.w == 1 ? layer->tris : layer->transparentTris;
+
+	unsigned int base = tris.vertices.count;
+	sm_singleton->copyVertices(tris.vertices, positions, stride, nullptr, 0, colour, count * 3);
+	sm_singleton->copyIndices(tris.indices, base, count * 3);
+}
+
+void Gizmos::addTris(const glm::vec3* positions, const glm::vec4* colours, unsigned int count,
+					 unsigned int positionStride, unsigned int colourStride) {
+	if (isChannelActive() == false || count == 0)
+		return;
+
+	// the whole batch is transparent if any of it is
+	bool opaque = true;
+	const char* colour = (const char*)colours;
+	for (unsigned int i = 0; i < count * 3 && opaque; ++i) {
+		opaque = ((const glm::vec4*)colour)->w == 1;
+		colour += colourStride != 0 ? colourStride : sizeof(glm::vec4);
 	}
+
+	Layer* layer = sm_singleton->getLayer();
+	GizmoBuffer& tris = opaque ? layer->tris : layer->transparentTris;
+
+	unsigned int base = tris.vertices.count;
+	sm_singleton->copyVertices(tris.vertices, positions, positionStride, colours, colourStride, glm::vec4(1), count * 3);
+	sm_singleton->copyIndices(tris.indices, base, count * 3);
+}
+
+void Gizmos::addPoints(const glm::vec3* positions, unsigned int count, const glm::vec4& colour, unsigned int stride) {
+	if (isChannelActive() == false || count == 0)
+		return;
+
+	Layer* layer = sm_singleton->getLayer();
+	sm_singleton->copyVertices(layer->points, positions, stride, nullptr, 0, colour, count);
+}
+
+void Gizmos::addPoints(const glm::vec3* positions, const glm::vec4* colours, unsigned int count,
+					   unsigned int positionStride, unsigned int colourStride) {
+	if (isChannelActive() == false || count == 0)
+		return;
+
+	Layer* layer = sm_singleton->getLayer();
+	sm_singleton->copyVertices(layer->points, positions, positionStride, colours, colourStride, glm::vec4(1), count);
+}
+
+void Gizmos::setPointSize(float pixels) {
+	if (sm_singleton != nullptr)
+		sm_singleton->m_pointSize = pixels;
 }
 
 void Gizmos::add2DAABB(const glm::vec2& center, const glm::vec2& extents, const glm::vec4& colour, const glm::mat4* transform /*= nullptr*/) {	
+	if (isChannelActive() == false)
+		return;
+
 	glm::vec2 verts[4];
 	glm::vec2 vX(extents.x, 0);
 	glm::vec2 vY(0, extents.y);
@@ -816,13 +2979,19 @@ void Gizmos::add2DAABB(const glm::vec2& center, const glm::vec2& extents, const
 	verts[2] = center - vX + vY;
 	verts[3] = center + vX + vY;
 
-	add2DLine(verts[0], verts[1], colour, colour);
-	add2DLine(verts[1], verts[3], colour, colour);
-	add2DLine(verts[2], verts[3], colour, colour);
-	add2DLine(verts[2], verts[0], colour, colour);
+	static const unsigned int indices[] = { 0, 1,  1, 3,  2, 3,  2, 0 };
+
+	Layer* layer = sm_singleton->getLayer();
+	unsigned int base = layer->lines2D.vertices.count;
+	for (auto& v : verts)
+		sm_singleton->addVertex(layer->lines2D, v.x, v.y, 1, colour);
+	sm_singleton->addIndices(layer->lines2D, indices, 8, base);
 }
 
 void Gizmos::add2DAABBFilled(const glm::vec2& center, const glm::vec2& extents, const glm::vec4& colour, const glm::mat4* transform /*= nullptr*/) {	
+	if (isChannelActive() == false)
+		return;
+
 	glm::vec2 verts[4];
 	glm::vec2 vX(extents.x, 0);
 	glm::vec2 vY(0, extents.y);
@@ -836,33 +3005,54 @@ void Gizmos::add2DAABBFilled(const glm::vec2& center, const glm::vec2& extents,
 	verts[1] = center + vX - vY;
 	verts[2] = center + vX + vY;
 	verts[3] = center - vX + vY;
-	
-	add2DTri(verts[0], verts[1], verts[2], colour);
-	add2DTri(verts[0], verts[2], verts[3], colour);
+
+	static const unsigned int indices[] = { 0, 1, 2,  0, 2, 3 };
+
+	Layer* layer = sm_singleton->getLayer();
+	unsigned int base = layer->tris2D.vertices.count;
+	for (auto& v : verts)
+		sm_singleton->addVertex(layer->tris2D, v.x, v.y, 1, colour);
+	sm_singleton->addIndices(layer->tris2D, indices, 6, base);
 }
 
 void Gizmos::add2DCircle(const glm::vec2& center, float radius, unsigned int segments, const glm::vec4& colour, const glm::mat4* transform /*= nullptr*/) {
+	if (isChannelActive() == false || segments == 0)
+		return;
+
 	glm::vec4 solidColour = colour;
 	solidColour.w = 1;
 
-	float segmentSize = (2 * glm::pi<float>()) / segments;
+	const float* circle = sm_singleton->getCircle(segments);
+
+	// centre then the edge, which wraps around
+	Layer* layer = sm_singleton->getLayer();
+	GizmoBuffer& buffer = colour.w != 0 ? layer->tris2D : layer->lines2D;
+	glm::vec4 vertexColour = colour.w != 0 ? colour : solidColour;
+
+	unsigned int base = sm_singleton->addVertex(buffer, center.x, center.y, 1, vertexColour);
 
 	for ( unsigned int i = 0 ; i < segments ; ++i ) {
-		glm::vec2 v1outer( sinf( i * segmentSize ) * radius, cosf( i * segmentSize ) * radius );
-		glm::vec2 v2outer( sinf( (i+1) * segmentSize ) * radius, cosf( (i+1) * segmentSize ) * radius );
+		glm::vec2 v( circle[i * 2] * radius, circle[i * 2 + 1] * radius );
 
-		if (transform != nullptr) {
-			v1outer = glm::vec2((*transform * glm::vec4(v1outer,0,0)));
-			v2outer = glm::vec2((*transform * glm::vec4(v2outer,0,0)));
-		}
+		if (transform != nullptr)
+			v = glm::vec2((*transform * glm::vec4(v,0,0)));
+
+		v += center;
+		sm_singleton->addVertex(buffer, v.x, v.y, 1, vertexColour);
+	}
+
+	for ( unsigned int i = 0 ; i < segments ; ++i ) {
+		unsigned int v1 = i + 1;
+		unsigned int v2 = (i + 1) % segments + 1;
 
 		if (colour.w != 0) {
-			add2DTri(center, center + v1outer, center + v2outer, colour);
-			add2DTri(center + v2outer, center + v1outer, center, colour);
+			unsigned int tris[] = { 0, v1, v2,  v2, v1, 0 };
+			sm_singleton->addIndices(buffer, tris, 6, base);
 		}
 		else {
 			// line
-			add2DLine(center + v1outer, center + v2outer, solidColour, solidColour);
+			unsigned int lines[] = { v1, v2 };
+			sm_singleton->addIndices(buffer, lines, 2, base);
 		}
 	}
 }
@@ -872,26 +3062,13 @@ void Gizmos::add2DLine(const glm::vec2& rv0,  const glm::vec2& rv1, const glm::v
 }
 
 void Gizmos::add2DLine(const glm::vec2& rv0, const glm::vec2& rv1, const glm::vec4& colour0, const glm::vec4& colour1) {
-	if (sm_singleton != nullptr &&
-		sm_singleton->m_2DlineCount < sm_singleton->m_max2DLines) {
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v0.x = rv0.x;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v0.y = rv0.y;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v0.z = 1;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v0.w = 1;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v0.r = colour0.r;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v0.g = colour0.g;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v0.b = colour0.b;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v0.a = colour0.a;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v1.x = rv1.x;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v1.y = rv1.y;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v1.z = 1;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v1.w = 1;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v1.r = colour1.r;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v1.g = colour1.g;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v1.b = colour1.b;
-		sm_singleton->m_2Dlines[sm_singleton->m_2DlineCount].v1.a = colour1.a;
-
-		sm_singleton->m_2DlineCount++;
+	if (isChannelActive()) {
+		static const unsigned int indices[] = { 0, 1 };
+
+		Layer* layer = sm_singleton->getLayer();
+		unsigned int base = sm_singleton->addVertex(layer->lines2D, rv0.x, rv0.y, 1, colour0);
+		sm_singleton->addVertex(layer->lines2D, rv1.x, rv1.y, 1, colour1);
+		sm_singleton->addIndices(layer->lines2D, indices, 2, base);
 	}
 }
 
@@ -900,35 +3077,14 @@ void Gizmos::add2DTri(const glm::vec2& rv0, const glm::vec2& rv1, const glm::vec
 }
 
 void Gizmos::add2DTri(const glm::vec2& rv0, const glm::vec2& rv1, const glm::vec2& rv2, const glm::vec4& colour0, const glm::vec4& colour1, const glm::vec4& colour2) {
-	if (sm_singleton != nullptr) {
-		if (sm_singleton->m_2DtriCount < sm_singleton->m_max2DTris) {
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v0.x = rv0.x;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v0.y = rv0.y;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v0.z = 1;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v0.w = 1;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v1.x = rv1.x;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v1.y = rv1.y;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v1.z = 1;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v1.w = 1;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v2.x = rv2.x;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v2.y = rv2.y;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v2.z = 1;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v2.w = 1;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v0.r = colour0.r;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v0.g = colour0.g;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v0.b = colour0.b;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v0.a = colour0.a;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v1.r = colour1.r;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v1.g = colour1.g;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v1.b = colour1.b;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v1.a = colour1.a;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v2.r = colour2.r;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v2.g = colour2.g;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v2.b = colour2.b;
-			sm_singleton->m_2Dtris[sm_singleton->m_2DtriCount].v2.a = colour2.a;
-
-			sm_singleton->m_2DtriCount++;
-		}
+	if (isChannelActive()) {
+		static const unsigned int indices[] = { 0, 1, 2 };
+
+		Layer* layer = sm_singleton->getLayer();
+		unsigned int base = sm_singleton->addVertex(layer->tris2D, rv0.x, rv0.y, 1, colour0);
+		sm_singleton->addVertex(layer->tris2D, rv1.x, rv1.y, 1, colour1);
+		sm_singleton->addVertex(layer->tris2D, rv2.x, rv2.y, 1, colour2);
+		sm_singleton->addIndices(layer->tris2D, indices, 3, base);
 	}
 }
 
@@ -937,65 +3093,105 @@ void Gizmos::draw(const glm::mat4& projection, const glm::mat4& view) {
 }
 
 void Gizmos::draw(const glm::mat4& projectionView) {
-	if ( sm_singleton != nullptr && 
-		(sm_singleton->m_lineCount > 0 || 
-		 sm_singleton->m_triCount > 0 || 
-		 sm_singleton->m_transparentTriCount > 0)) {
-		int shader = 0;
-		glGetIntegerv(GL_CURRENT_PROGRAM, &shader);
+	if (sm_singleton == nullptr)
+		return;
+
+	int shader = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &shader);
+
+	// each thread's geometry uploads from its own layer, then everything draws together
+	std::vector<Layer*> layers;
+	sm_singleton->getFrameLayers(layers);
+	for (auto layer : layers)
+		sm_singleton->uploadLayer(*layer, GL_STREAM_DRAW);
+
+	sm_singleton->uploadGroups();
+	sm_singleton->getGroupLayers(layers);
+
+	// shapes expanded on the GPU must be written before any are drawn
+	bool expanded = false;
+	for (auto layer : layers) {
+		if (layer->compute.shapeCount > 0) {
+			sm_singleton->expandComputeBatch(layer->compute, projectionView * glm::make_mat4(layer->transform));
+			expanded = true;
+		}
+	}
+	if (expanded)
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	// points are a fixed size on screen
+	float pointSize = 1;
+	glGetFloatv(GL_POINT_SIZE, &pointSize);
+	glPointSize(sm_singleton->m_pointSize);
+
+	bool transparent = false;
+	for (auto layer : layers) {
+		sm_singleton->drawLayer(*layer, projectionView, false);
+		transparent |= sm_singleton->hasTransparent(*layer);
+	}
 
-		glUseProgram(sm_singleton->m_shader);
-		
-		unsigned int projectionViewUniform = glGetUniformLocation(sm_singleton->m_shader,"ProjectionView");
-		glUniformMatrix4fv(projectionViewUniform, 1, false, glm::value_ptr(projectionView));
+	float time = sm_singleton->getTime();
+	sm_singleton->updateTimedRing(sm_singleton->m_timedLines, time);
+	sm_singleton->updateTimedRing(sm_singleton->m_timedTris, time);
 
-		if (sm_singleton->m_lineCount > 0) {
-			glBindBuffer(GL_ARRAY_BUFFER, sm_singleton->m_lineVBO);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sm_singleton->m_lineCount * sizeof(GizmoLine), sm_singleton->m_lines);
+	if (sm_singleton->m_timedLines.count > 0 ||
+		sm_singleton->m_timedTris.count > 0) {
+		unsigned int program = sm_singleton->m_timedShader;
+		glUseProgram(program);
+		glUniformMatrix4fv(glGetUniformLocation(program, "ProjectionView"), 1, false, glm::value_ptr(projectionView));
+		glUniform1f(glGetUniformLocation(program, "Time"), time);
 
-			glBindVertexArray(sm_singleton->m_lineVAO);
-			glDrawArrays(GL_LINES, 0, sm_singleton->m_lineCount * 2);
-		}
+		sm_singleton->drawTimedRing(sm_singleton->m_timedLines, GL_LINES);
+		sm_singleton->drawTimedRing(sm_singleton->m_timedTris, GL_TRIANGLES);
+	}
 
-		if (sm_singleton->m_triCount > 0) {
-			glBindBuffer(GL_ARRAY_BUFFER, sm_singleton->m_triVBO);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sm_singleton->m_triCount * sizeof(GizmoTri), sm_singleton->m_tris);
+	glPointSize(pointSize);
 
-			glBindVertexArray(sm_singleton->m_triVAO);
-			glDrawArrays(GL_TRIANGLES, 0, sm_singleton->m_triCount * 3);
-		}
+	if (transparent) {
+		// not ideal to store these, but Gizmos must work stand-alone
+		GLboolean blendEnabled = glIsEnabled(GL_BLEND);
+		GLboolean depthMask = GL_TRUE;
+		glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+		int src, dst;
+		glGetIntegerv(GL_BLEND_SRC, &src);
+		glGetIntegerv(GL_BLEND_DST, &dst);
 		
-		if (sm_singleton->m_transparentTriCount > 0) {
-			// not ideal to store these, but Gizmos must work stand-alone
-			GLboolean blendEnabled = glIsEnabled(GL_BLEND);
-			GLboolean depthMask = GL_TRUE;
-			glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
-			int src, dst;
-			glGetIntegerv(GL_BLEND_SRC, &src);
-			glGetIntegerv(GL_BLEND_DST, &dst);
-			
-			// setup blend states
-			if (blendEnabled == GL_FALSE)
-				glEnable(GL_BLEND);
-			
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-			glDepthMask(GL_FALSE);
-
-			glBindBuffer(GL_ARRAY_BUFFER, sm_singleton->m_transparentTriVBO);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sm_singleton->m_transparentTriCount * sizeof(GizmoTri), sm_singleton->m_transparentTris);
+		// setup blend states
+		if (blendEnabled == GL_FALSE)
+			glEnable(GL_BLEND);
+		
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDepthMask(GL_FALSE);
 
-			glBindVertexArray(sm_singleton->m_transparentTriVAO);
-			glDrawArrays(GL_TRIANGLES, 0, sm_singleton->m_transparentTriCount * 3);
+		if (sm_singleton->m_weightedTransparency &&
+			sm_singleton->drawWeighted(layers, projectionView)) {
 
-			// reset state
-			glDepthMask(depthMask);
-			glBlendFunc(src, dst);
-			if (blendEnabled == GL_FALSE)
-				glDisable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			for (auto layer : layers) {
+				glm::mat4 transform = projectionView * glm::make_mat4(layer->transform);
+				if (layer->grids.empty() == false)
+					sm_singleton->drawGrids(*layer, transform);
+				if (layer->glyphCount + layer->overlayGlyphCount > 0)
+					sm_singleton->drawText(*layer, transform);
+			}
+		}
+		else {
+			for (auto layer : layers)
+				sm_singleton->drawLayer(*layer, projectionView, true);
 		}
 
-		glUseProgram(shader);
+		// reset state
+		glDepthMask(depthMask);
+		glBlendFunc(src, dst);
+		if (blendEnabled == GL_FALSE)
+			glDisable(GL_BLEND);
 	}
+
+	if (expanded)
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glBindVertexArray(0);
+	glUseProgram(shader);
 }
 
 void Gizmos::draw2D(float screenWidth, float screenHeight) {
@@ -1003,26 +3199,46 @@ void Gizmos::draw2D(float screenWidth, float screenHeight) {
 }
 
 void Gizmos::draw2D(const glm::mat4& projection) {
-	if ( sm_singleton != nullptr && 
-		(sm_singleton->m_2DlineCount > 0 || 
-		 sm_singleton->m_2DtriCount > 0)) {
+	if (sm_singleton == nullptr)
+		return;
+
+	std::vector<Layer*> layers;
+	sm_singleton->getFrameLayers(layers);
+
+	for (auto layer : layers) {
+		sm_singleton->uploadBuffer(layer->lines2D, GL_STREAM_DRAW);
+		sm_singleton->uploadBuffer(layer->tris2D, GL_STREAM_DRAW);
+	}
+
+	sm_singleton->uploadGroups();
+	sm_singleton->getGroupLayers(layers);
+
+	bool lines = false, tris = false;
+	for (auto layer : layers) {
+		lines |= layer->lines2D.indexCount > 0;
+		tris |= layer->tris2D.indexCount > 0;
+	}
+
+	if (lines || tris) {
 		int shader = 0;
 		glGetIntegerv(GL_CURRENT_PROGRAM, &shader);
 
 		glUseProgram(sm_singleton->m_shader);
 		
+		// groups are moved by their transform, as in 3D
 		unsigned int projectionViewUniform = glGetUniformLocation(sm_singleton->m_shader,"ProjectionView");
-		glUniformMatrix4fv(projectionViewUniform, 1, false, glm::value_ptr(projection));
-
-		if (sm_singleton->m_2DlineCount > 0) {
-			glBindBuffer(GL_ARRAY_BUFFER, sm_singleton->m_2DlineVBO);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sm_singleton->m_2DlineCount * sizeof(GizmoLine), sm_singleton->m_2Dlines);
 
-			glBindVertexArray(sm_singleton->m_2DlineVAO);
-			glDrawArrays(GL_LINES, 0, sm_singleton->m_2DlineCount * 2);
+		if (lines) {
+			for (auto layer : layers) {
+				if (layer->lines2D.indexCount == 0)
+					continue;
+				glm::mat4 transform = projection * glm::make_mat4(layer->transform);
+				glUniformMatrix4fv(projectionViewUniform, 1, false, glm::value_ptr(transform));
+				sm_singleton->drawBuffer(layer->lines2D, GL_LINES);
+			}
 		}
 
-		if (sm_singleton->m_2DtriCount > 0) {
+		if (tris) {
 			GLboolean blendEnabled = glIsEnabled(GL_BLEND);
 
 			GLboolean depthMask = GL_TRUE;
@@ -1039,11 +3255,13 @@ void Gizmos::draw2D(const glm::mat4& projection) {
 
 			glDepthMask(GL_FALSE);
 
-			glBindBuffer(GL_ARRAY_BUFFER, sm_singleton->m_2DtriVBO);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sm_singleton->m_2DtriCount * sizeof(GizmoTri), sm_singleton->m_2Dtris);
-
-			glBindVertexArray(sm_singleton->m_2DtriVAO);
-			glDrawArrays(GL_TRIANGLES, 0, sm_singleton->m_2DtriCount * 3);
+			for (auto layer : layers) {
+				if (layer->tris2D.indexCount == 0)
+					continue;
+				glm::mat4 transform = projection * glm::make_mat4(layer->transform);
+				glUniformMatrix4fv(projectionViewUniform, 1, false, glm::value_ptr(transform));
+				sm_singleton->drawBuffer(layer->tris2D, GL_TRIANGLES);
+			}
 
 			glDepthMask(depthMask);
 
@@ -1057,4 +3275,6 @@ void Gizmos::draw2D(const glm::mat4& projection) {
 	}
 }
 
-} // namespace aie
\ No newline at end of file
+} // namespace aie
+
+#endif // AIE_GIZMOS_DISABLED
\ No newline at end of file
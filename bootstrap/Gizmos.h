@@ -1,95 +1,240 @@
 #pragma once
 
 #include <glm/fwd.hpp>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <string>
+
+// defining AIE_GIZMOS_DISABLED, for the bootstrap and the project using it, turns every public
+// Gizmos function into an empty inline function so shipping builds pay nothing for gizmo calls
+#ifdef AIE_GIZMOS_DISABLED
+#define AIE_GIZMOS_API(...) { return __VA_ARGS__; }
+#else
+#define AIE_GIZMOS_API(...)
+#endif
 
 namespace aie {
 
-// a singleton class for rendering immediate-mode 3-D primitives
+class Font;
+
+// a singleton class for rendering immediate-mode 3-D primitives.
+// the add functions may be called from any thread, with each thread writing to its own
+// buffers that are merged when drawn. draw(), clear() and the group functions other than
+// beginGroup() / endGroup() belong to the thread that called create(), and other threads
+// must have finished adding before it calls draw() or clear()
 class Gizmos {
 public:
 
+	// the max values are a starting size only, storage grows when more is added
 	static void		create(unsigned int maxLines, unsigned int maxTris,
-						   unsigned int max2DLines, unsigned int max2DTris);
-	static void		destroy();
+						   unsigned int max2DLines, unsigned int max2DTris) AIE_GIZMOS_API();
+	static void		destroy() AIE_GIZMOS_API();
 
 	// removes all Gizmos
-	static void		clear();
+	static void		clear() AIE_GIZMOS_API();
 
 	// draws current Gizmo buffers, either using a combined (projection * view) matrix, or separate matrices
-	static void		draw(const glm::mat4& projectionView);
-	static void		draw(const glm::mat4& projection, const glm::mat4& view);
+	static void		draw(const glm::mat4& projectionView) AIE_GIZMOS_API();
+	static void		draw(const glm::mat4& projection, const glm::mat4& view) AIE_GIZMOS_API();
 	
 	// the projection matrix here should ideally be orthographic with a near of -1 and far of 1
-	static void		draw2D(const glm::mat4& projection);
-	static void		draw2D(float screenWidth, float screenHeight);
+	static void		draw2D(const glm::mat4& projection) AIE_GIZMOS_API();
+	static void		draw2D(float screenWidth, float screenHeight) AIE_GIZMOS_API();
+
+	// optional, and called before adding. shapes outside the camera's view are skipped, and the
+	// segments, rows and columns passed in become a maximum that is reduced to suit each shape's
+	// size on screen. tolerance is the most, in pixels, that a curved edge may stray from the true
+	// shape. groups are never culled or reduced as they may be drawn from anywhere
+	static void		setCamera(const glm::mat4& projection, const glm::mat4& view,
+							  float viewportHeight, float tolerance = 0.5f) AIE_GIZMOS_API();
+	static void		clearCamera() AIE_GIZMOS_API();
 
 	// adds a single debug line
-	static void		addLine(const glm::vec3& v0, const glm::vec3& v1, const glm::vec4& colour);
+	static void		addLine(const glm::vec3& v0, const glm::vec3& v1, const glm::vec4& colour) AIE_GIZMOS_API();
 
 	// adds a single debug line
-	static void		addLine(const glm::vec3& v0, const glm::vec3& v1, const glm::vec4& colour0, const glm::vec4& colour1);
+	static void		addLine(const glm::vec3& v0, const glm::vec3& v1, const glm::vec4& colour0, const glm::vec4& colour1) AIE_GIZMOS_API();
 
 	// adds a triangle
-	static void		addTri(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const glm::vec4& colour);
+	static void		addTri(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const glm::vec4& colour) AIE_GIZMOS_API();
+
+	// adds lines that are width pixels wide whatever their distance, with dashes and gaps of
+	// dashLength pixels, or an arrow head at the end that is headSize pixels long and wide
+	static void		addThickLine(const glm::vec3& start, const glm::vec3& end, const glm::vec4& colour, float width) AIE_GIZMOS_API();
+	static void		addDashedLine(const glm::vec3& start, const glm::vec3& end, const glm::vec4& colour, float width, float dashLength) AIE_GIZMOS_API();
+	static void		addArrow(const glm::vec3& start, const glm::vec3& end, const glm::vec4& colour, float width, float headSize) AIE_GIZMOS_API();
+
+	// timed gizmos stay for duration seconds and aren't removed by clear(), useful for events such as
+	// raycasts and collisions. they're kept in a ring buffer on the GPU so each is only uploaded once.
+	// timed triangles are always drawn opaque
+	static void		addLine(const glm::vec3& v0, const glm::vec3& v1, const glm::vec4& colour, float duration) AIE_GIZMOS_API();
+	static void		addTri(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const glm::vec4& colour, float duration) AIE_GIZMOS_API();
+
+	// removes all timed gizmos
+	static void		clearTimed() AIE_GIZMOS_API();
+
+	// bulk adds for large data sets, such as point clouds, with count lines, triangles or points.
+	// positions and colours are read with a stride in bytes from one to the next, with 0 meaning
+	// tightly packed, and there is a colour for each position. a batch of triangles is drawn
+	// transparent if any of its colours are
+	static void		addLines(const glm::vec3* positions, unsigned int count, const glm::vec4& colour, unsigned int stride = 0) AIE_GIZMOS_API();
+	static void		addLines(const glm::vec3* positions, const glm::vec4* colours, unsigned int count,
+							 unsigned int positionStride = 0, unsigned int colourStride = 0) AIE_GIZMOS_API();
+	static void		addTris(const glm::vec3* positions, unsigned int count, const glm::vec4& colour, unsigned int stride = 0) AIE_GIZMOS_API();
+	static void		addTris(const glm::vec3* positions, const glm::vec4* colours, unsigned int count,
+							unsigned int positionStride = 0, unsigned int colourStride = 0) AIE_GIZMOS_API();
+	static void		addPoints(const glm::vec3* positions, unsigned int count, const glm::vec4& colour, unsigned int stride = 0) AIE_GIZMOS_API();
+	static void		addPoints(const glm::vec3* positions, const glm::vec4* colours, unsigned int count,
+							  unsigned int positionStride = 0, unsigned int colourStride = 0) AIE_GIZMOS_API();
+
+	// the size of points on screen, in pixels
+	static void		setPointSize(float pixels) AIE_GIZMOS_API();
+
+	// when enabled, transparent triangles are drawn with weighted, blended order-independent
+	// transparency, so overlapping shapes look right without sorting. the blending is an
+	// approximation that favours nearer surfaces. grids are still blended as before.
+	// ignored unless OpenGL 4.0 is available. targets that are multisampled or don't have a
+	// 24-bit depth and 8-bit stencil buffer fall back to the usual blending
+	static void		setWeightedTransparency(bool enabled) AIE_GIZMOS_API();
+
+	// when enabled, arcs, arc rings and partial spheres are added as small descriptions that a compute
+	// shader expands into vertices when drawn, so adding one costs the same however many segments it
+	// has. they're also culled on the GPU each draw. ignored unless OpenGL 4.3 is available
+	static void		setComputeTessellation(bool enabled) AIE_GIZMOS_API();
 
 	// adds 3 unit-length lines (red,green,blue) representing the 3 axis of a transform, 
 	// at the transform's translation. Optional scale available
-	static void		addTransform(const glm::mat4& transform, float scale = 1.0f);
+	static void		addTransform(const glm::mat4& transform, float scale = 1.0f) AIE_GIZMOS_API();
 	
 	// adds a wireframe Axis-Aligned Bounding-Box with optional transform for rotation/translation
 	static void		addAABB(const glm::vec3& center, const glm::vec3& extents, 
-							const glm::vec4& colour, const glm::mat4* transform = nullptr);
+							const glm::vec4& colour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
 
 	// adds an Axis-Aligned Bounding-Box with optional transform for rotation
 	static void		addAABBFilled(const glm::vec3& center, const glm::vec3& extents, 
-								  const glm::vec4& fillColour, const glm::mat4* transform = nullptr);
+								  const glm::vec4& fillColour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
 
 	// adds a cylinder aligned to the Y-axis with optional transform for rotation
 	static void		addCylinderFilled(const glm::vec3& center, float radius, float halfLength,
-									  unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr);
+									  unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
 
 	// adds a double-sided hollow ring in the XZ axis with optional transform for rotation.
 	// if fillColour.w == 0 then only an outer and inner line is drawn
 	static void		addRing(const glm::vec3& center, float innerRadius, float outerRadius,
-							unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr);
+							unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
 
 	// adds a double-sided disk in the XZ axis with optional transform for rotation.
 	// if fillColour.w == 0 then only an outer line is drawn
 	static void		addDisk(const glm::vec3& center, float radius,
-							unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr);
+							unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
 
 	// adds an arc, around the Y-axis
 	// if fillColour.w == 0 then only an outer line is drawn
 	static void		addArc(const glm::vec3& center, float rotation, float radius, float halfAngle,
-						   unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr);
+						   unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
 
 	// adds an arc, around the Y-axis, starting at the inner radius and extending to the outer radius
 	// if fillColour.w == 0 then only an outer line is drawn
 	static void		addArcRing(const glm::vec3& center, float rotation, 
 							   float innerRadius, float outerRadius, float arcHalfAngle,
-							   unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr);
+							   unsigned int segments, const glm::vec4& fillColour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
 
 	// adds a Sphere at a given position, with a given number of rows, and columns, radius and a max and min long and latitude
 	static void		addSphere(const glm::vec3& center, float radius, int rows, int columns, const glm::vec4& fillColour, 
 							  const glm::mat4* transform = nullptr, float longMin = 0.f, float longMax = 360, 
-							  float latMin = -90, float latMax = 90 );
+							  float latMin = -90, float latMax = 90 ) AIE_GIZMOS_API();
 
 	// adds a capsule with a set height and radius
 	static void		addCapsule(const glm::vec3& center, float height, float radius,
-							   int rows, int cols, const glm::vec4& fillColour, const glm::mat4* rotation = nullptr);
-
-	// adds a single Hermite spline curve
+							   int rows, int cols, const glm::vec4& fillColour, const glm::mat4* rotation = nullptr) AIE_GIZMOS_API();
+
+	// adds a grid on the plane through center with the given normal, with lines every spacing units
+	// out to extent from the center, or fading into the distance if extent is 0. the grid is drawn
+	// in a shader, so costs the same whatever its size. the lines through the center use axisColour
+	static void		addGrid(const glm::vec3& center, const glm::vec3& normal, float spacing, float extent,
+							const glm::vec4& colour, const glm::vec4& axisColour) AIE_GIZMOS_API();
+
+	// curves are sent to the GPU as their four bezier control points and tessellated in a shader,
+	// with each using as many of its segments as its size on screen needs. Catmull-Rom curves pass
+	// through every point, while B-splines are smoother and only pass near them.
+	// a curve is added for each span between the points
+	static void		addBezier(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3,
+							  unsigned int segments, const glm::vec4& colour) AIE_GIZMOS_API();
+	static void		addCatmullRom(const glm::vec3* points, unsigned int count,
+								  unsigned int segments, const glm::vec4& colour) AIE_GIZMOS_API();
+	static void		addBSpline(const glm::vec3* points, unsigned int count,
+							   unsigned int segments, const glm::vec4& colour) AIE_GIZMOS_API();
+
+	// the font used by addText3D(), which must stay loaded while gizmos using it are drawn
+	static void		setFont(Font* font) AIE_GIZMOS_API();
+
+	// adds a line of text centred above position that faces the camera and stays the font's size on
+	// screen. with a camera set, labels outside the view or further away than maxDistance (if not 0)
+	// are skipped before any layout. text that isn't depth tested is drawn over everything
+	static void		addText3D(const glm::vec3& position, const char* text, const glm::vec4& colour,
+							  float maxDistance = 0, bool depthTest = true) AIE_GIZMOS_API();
+
+	// adds a single Hermite spline curve, drawn the same way as the curves above
 	static void		addHermiteSpline(const glm::vec3& start, const glm::vec3& end,
-									 const glm::vec3& tangentStart, const glm::vec3& tangentEnd, unsigned int segments, const glm::vec4& colour);
+									 const glm::vec3& tangentStart, const glm::vec3& tangentEnd, unsigned int segments, const glm::vec4& colour) AIE_GIZMOS_API();
 
 	// 2-dimensional gizmos
-	static void		add2DLine(const glm::vec2& start, const glm::vec2& end, const glm::vec4& colour);
-	static void		add2DLine(const glm::vec2& start, const glm::vec2& end, const glm::vec4& colour0, const glm::vec4& colour1);
-	static void		add2DTri(const glm::vec2& v0, const glm::vec2& v1, const glm::vec2& v2, const glm::vec4& colour);
-	static void		add2DTri(const glm::vec2& v0, const glm::vec2& v1, const glm::vec2& v2, const glm::vec4& colour0, const glm::vec4& colour1, const glm::vec4& colour2);
-	static void		add2DAABB(const glm::vec2& center, const glm::vec2& extents, const glm::vec4& colour, const glm::mat4* transform = nullptr);	
-	static void		add2DAABBFilled(const glm::vec2& center, const glm::vec2& extents, const glm::vec4& colour, const glm::mat4* transform = nullptr);	
-	static void		add2DCircle(const glm::vec2& center, float radius, unsigned int segments, const glm::vec4& colour, const glm::mat4* transform = nullptr);
+	static void		add2DLine(const glm::vec2& start, const glm::vec2& end, const glm::vec4& colour) AIE_GIZMOS_API();
+	static void		add2DLine(const glm::vec2& start, const glm::vec2& end, const glm::vec4& colour0, const glm::vec4& colour1) AIE_GIZMOS_API();
+	static void		add2DTri(const glm::vec2& v0, const glm::vec2& v1, const glm::vec2& v2, const glm::vec4& colour) AIE_GIZMOS_API();
+	static void		add2DTri(const glm::vec2& v0, const glm::vec2& v1, const glm::vec2& v2, const glm::vec4& colour0, const glm::vec4& colour1, const glm::vec4& colour2) AIE_GIZMOS_API();
+	static void		add2DAABB(const glm::vec2& center, const glm::vec2& extents, const glm::vec4& colour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
+	static void		add2DAABBFilled(const glm::vec2& center, const glm::vec2& extents, const glm::vec4& colour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
+	static void		add2DCircle(const glm::vec2& center, float radius, unsigned int segments, const glm::vec4& colour, const glm::mat4* transform = nullptr) AIE_GIZMOS_API();
+
+	// channels let whole categories of gizmos be hidden, such as physics or AI debugging. add calls
+	// go to the channel last set on the same thread, and are rejected before doing any work while
+	// that channel is disabled. channel 0 is the default and there may be up to 64.
+	// groups keep what was accepted when they were built.
+	// registering a name again returns the same channel, and 0 is returned once all 64 are used
+	static unsigned int	registerChannel(const char* name) AIE_GIZMOS_API(0);
+
+	// returns the channel registered with a name, or 0 if there isn't one
+	static unsigned int	findChannel(const char* name) AIE_GIZMOS_API(0);
+
+	static void		setChannel(unsigned int channel) AIE_GIZMOS_API();
+	static void		setChannelEnabled(unsigned int channel, bool enabled) AIE_GIZMOS_API();
+	static bool		isChannelEnabled(unsigned int channel) AIE_GIZMOS_API(false);
+
+	// retained gizmos: everything added between beginGroup() and endGroup() is uploaded once
+	// to its own buffers and drawn every frame, unaffected by clear(), until removeGroup().
+	// groups are per-thread, so each thread may build one at a time.
+	// returns a handle to the group, or 0 if this thread is already building a group
+	static unsigned int	beginGroup() AIE_GIZMOS_API(0);
+	static void		endGroup() AIE_GIZMOS_API();
+	static void		removeGroup(unsigned int group) AIE_GIZMOS_API();
+
+	// moves a whole group without rebuilding it, including its 2D shapes
+	static void		setGroupTransform(unsigned int group, const glm::mat4& transform) AIE_GIZMOS_API();
+	static void		setGroupVisible(unsigned int group, bool visible) AIE_GIZMOS_API();
+
+	struct Statistics {
+		unsigned int lines;
+		unsigned int tris;
+		unsigned int transparentTris;
+		unsigned int lines2D;
+		unsigned int tris2D;
+		unsigned int points;
+
+		// cylinders, rings, disks, spheres and capsules are drawn as instances of cached
+		// unit meshes, with their fill and outline each counting as one
+		unsigned int shapes;
+	};
+
+	// the number of each primitive added since the last clear(), across all threads
+	static Statistics	getCounts() AIE_GIZMOS_API(Statistics());
+
+	// the most of each primitive there has been at once since create(),
+	// useful for picking the sizes passed to create()
+	static Statistics	getHighWaterMarks() AIE_GIZMOS_API(Statistics());
 	
 private:
 
@@ -97,61 +242,405 @@ private:
 		   unsigned int max2DLines, unsigned int max2DTris);
 	~Gizmos();
 
+	// 16 bytes, with the colour as normalised bytes
 	struct GizmoVertex {
-		float x, y, z, w;
-		float r, g, b, a;
+		float x, y, z;
+		unsigned char r, g, b, a;
 	};
 
-	struct GizmoLine {
-		GizmoVertex v0;
-		GizmoVertex v1;
+	static void		setVertex(GizmoVertex& vertex, float x, float y, float z, const glm::vec4& colour);
+
+	// primitives are stored in fixed-size blocks from an arena shared by all streams,
+	// so adding never moves or drops data, and clear() hands the blocks back for reuse
+	enum : unsigned int { BLOCK_SIZE = 96 * 1024 };
+
+	struct GizmoStream {
+		std::vector<char*>	blocks;
+		unsigned int		elementSize;
+		unsigned int		elementsPerBlock;
+		unsigned int		count;
+		unsigned int		highWaterMark;
+
+		// GPU buffer, with capacity in elements
+		unsigned int		capacity;
+		unsigned int		buffer;
 	};
 
-	struct GizmoTri {
-		GizmoVertex v0;
-		GizmoVertex v1;
-		GizmoVertex v2;
+	// indexed primitives, so shapes can share vertices between their lines or faces
+	struct GizmoBuffer {
+		GizmoStream			vertices;
+		GizmoStream			indices;
+		unsigned int		vao;
+
+		// indices in the GPU buffer
+		unsigned int		indexCount;
 	};
 
+	void			initStream(GizmoStream& stream, unsigned int elementSize, unsigned int reserve);
+	void			destroyStream(GizmoStream& stream);
+	void			resetStream(GizmoStream& stream);
+	void*			allocate(GizmoStream& stream);
+
+	// allocates up to count elements that are contiguous, returning how many in allocated
+	void*			allocate(GizmoStream& stream, unsigned int count, unsigned int& allocated);
+	void			upload(GizmoStream& stream, unsigned int target, unsigned int usage);
+
+	void			initBuffer(GizmoBuffer& buffer, unsigned int vertexReserve, unsigned int indexReserve);
+	void			destroyBuffer(GizmoBuffer& buffer);
+	void			resetBuffer(GizmoBuffer& buffer);
+	void			uploadBuffer(GizmoBuffer& buffer, unsigned int usage);
+	void			drawBuffer(const GizmoBuffer& buffer, unsigned int mode);
+
+	// returns the index of the (first) vertex added
+	unsigned int	addVertex(GizmoBuffer& buffer, float x, float y, float z, const glm::vec4& colour);
+	unsigned int	addVertices(GizmoBuffer& buffer, const glm::vec3* positions, unsigned int count, const glm::vec4& colour);
+
+	// adds indices relative to a base vertex
+	void			addIndices(GizmoBuffer& buffer, const unsigned int* indices, unsigned int count, unsigned int base);
+
+	// bulk copies for the array add functions, with null colours using the one colour,
+	// and indices counting up from base
+	void			copyVertices(GizmoStream& stream, const glm::vec3* positions, unsigned int positionStride,
+								 const glm::vec4* colours, unsigned int colourStride, const glm::vec4& colour, unsigned int count);
+	void			copyIndices(GizmoStream& stream, unsigned int base, unsigned int count);
+
 	unsigned int	m_shader;
 
-	// line data
-	unsigned int	m_maxLines;
-	unsigned int	m_lineCount;
-	GizmoLine*		m_lines;
+	// shared by all threads, so only taken when a stream needs or returns a block
+	std::vector<char*>	m_freeBlocks;
+	std::mutex		m_arenaMutex;
+
+	// shapes are drawn as instances of unit meshes, cached per shape and rows / columns
+	enum Shape : unsigned char {
+		CYLINDER,
+		RING,
+		DISK,
+		SPHERE,
+		CAPSULE,
+	};
 
-	unsigned int	m_lineVAO;
-	unsigned int 	m_lineVBO;
+	struct GizmoInstance {
+		float			transform[16];
+		unsigned char	r, g, b, a;
+		float			params[2];
+	};
 
-	// triangle data
-	unsigned int	m_maxTris;
-	unsigned int	m_triCount;
-	GizmoTri*		m_tris;
+	struct UnitMesh {
+		unsigned int	vao;
+		unsigned int	vbo;
+		unsigned int	ibo;
 
-	unsigned int	m_triVAO;
-	unsigned int 	m_triVBO;
-	
-	unsigned int	m_transparentTriCount;
-	GizmoTri*		m_transparentTris;
+		// lines follow the triangles in the index buffer
+		unsigned int	triIndexCount;
+		unsigned int	lineIndexCount;
 
-	unsigned int	m_transparentTriVAO;
-	unsigned int 	m_transparentTriVBO;
-	
-	// 2D line data
-	unsigned int	m_max2DLines;
-	unsigned int	m_2DlineCount;
-	GizmoLine*		m_2Dlines;
+		// kept until the first draw creates the GL objects, as meshes can be made on any thread
+		std::vector<float>			vertices;
+		std::vector<unsigned int>	indices;
+	};
+
+	// a layer's instances of one unit mesh
+	struct MeshInstances {
+		UnitMesh*					mesh;
+		std::vector<GizmoInstance>	lines;
+		std::vector<GizmoInstance>	tris;
+		std::vector<GizmoInstance>	transparentTris;
+
+		// ranges in the layer's instance buffer
+		unsigned int	lineBase, lineCount;
+		unsigned int	triBase, triCount;
+		unsigned int	transparentTriBase, transparentTriCount;
+	};
+
+	struct GizmoGrid {
+		float			center[3];
+		float			axisU[3];
+		float			axisV[3];
+		float			spacing;
+		float			extent;
+		float			colour[4];
+		float			axisColour[4];
+	};
+
+	// 40 bytes, expanded to a screen-space quad and arrow head by the segment shader
+	struct GizmoSegment {
+		float			start[3];
+		float			end[3];
+		unsigned char	r, g, b, a;
+		float			width;
+		float			dashLength;
+		float			headSize;
+	};
+
+	// 144 bytes, matching the std430 layout read by the compute shader
+	struct GizmoShape {
+		float			transform[16];
+		float			colour[4];
+		float			lineColour[4];
+		float			ranges[4];
+		float			bounds[4];
+		unsigned int	info[4];
+	};
+
+	// the surfaces a shape's rows and columns are spread across
+	enum PatchType : unsigned int {
+		SPHERE_PATCH,	// longitude and latitude on a unit sphere
+		RING_PATCH,		// angle and radius in the XZ plane
+	};
+
+	enum ShapeFlags : unsigned int {
+		SHAPE_FILLED = 1,
+		SHAPE_DOUBLE_SIDED = 2,
+		SHAPE_TRANSPARENT = 4,
+		SHAPE_GRID_LINES = 8,
+		SHAPE_BORDER_LINES = 16,
+	};
+
+	// the expanded vertices are split into opaque triangles, transparent triangles and lines,
+	// each drawn with its own indirect command. the region sizes are the most each could need
+	struct ComputeBatch {
+		std::vector<GizmoShape>	shapes;
+		unsigned int	shapeCount;
+		unsigned int	shapeCapacity;
+		unsigned int	regionSize[3];
+		unsigned int	regionFirst[3];
+		unsigned int	vertexCapacity;
+
+		unsigned int	shapeBuffer;
+		unsigned int	vertexBuffer;
+		unsigned int	commandBuffer;
+		unsigned int	vao;
+	};
+
+	// 56 bytes, a cubic bezier tessellated by the curve shader
+	struct GizmoCurve {
+		float			points[12];
+		unsigned char	r, g, b, a;
+		float			segments;
+	};
+
+	// 48 bytes, a glyph's pixel offsets from its label's position and its place in the font's texture
+	struct GizmoGlyph {
+		float			position[3];
+		float			offset[4];
+		float			texCoords[4];
+		unsigned char	r, g, b, a;
+	};
+
+	// all the geometry for one thread's frame, or one retained group
+	struct Layer {
+		GizmoBuffer		lines;
+		GizmoBuffer		tris;
+		GizmoBuffer		transparentTris;
+		GizmoBuffer		lines2D;
+		GizmoBuffer		tris2D;
+
+		std::vector<GizmoGrid>	grids;
+
+		// points aren't indexed
+		GizmoStream		points;
+		unsigned int	pointCount;
+		unsigned int	pointVAO;
+
+		std::vector<GizmoSegment>	segments;
+		unsigned int	segmentCount;
+		unsigned int	segmentCapacity;
+		unsigned int	segmentVBO;
+
+		// curves draw as many segments as the most any of them asked for
+		std::vector<GizmoCurve>	curves;
+		unsigned int	curveCount;
+		unsigned int	curveCapacity;
+		unsigned int	curveSegments;
+		unsigned int	curveVBO;
+
+		// glyphs that aren't depth tested are uploaded after the rest
+		std::vector<GizmoGlyph>	glyphs;
+		std::vector<GizmoGlyph>	overlayGlyphs;
+		unsigned int	glyphCount;
+		unsigned int	overlayGlyphCount;
+		unsigned int	glyphCapacity;
+		unsigned int	glyphVBO;
+
+		ComputeBatch	compute;
+
+		// keyed by shape, rows and columns
+		std::map<unsigned long long, MeshInstances>	instances;
+		unsigned int	instanceCount;
+		unsigned int	instanceHighWaterMark;
+		unsigned int	instanceCapacity;
+		unsigned int	instanceVBO;
+
+		// groups are uploaded by the first draw after endGroup()
+		bool			building;
+		bool			pendingUpload;
+
+		// set when a thread's layer outlives the thread, and deleted by the next clear()
+		bool			abandoned;
+
+		bool			visible;
+		float			transform[16];
+	};
+
+	UnitMesh*		getUnitMesh(Shape shape, unsigned int rows, unsigned int cols);
+	void			createMeshObjects(UnitMesh* mesh);
+	MeshInstances*	getInstances(Layer* layer, Shape shape, unsigned int rows, unsigned int cols);
+	void			addInstance(Layer& layer, std::vector<GizmoInstance>& instances, const glm::mat4& transform,
+								const glm::vec4& colour, float param0 = 0, float param1 = 0);
+	void			bindInstances(unsigned int vbo, unsigned int base);
+
+	void			initLayer(Layer& layer, unsigned int lineReserve, unsigned int triReserve,
+							  unsigned int line2DReserve, unsigned int tri2DReserve);
+	void			destroyLayer(Layer& layer);
+	void			resetLayer(Layer& layer);
+	void			uploadLayer(Layer& layer, unsigned int usage);
+	void			uploadGroups();
+	void			drawLayer(const Layer& layer, const glm::mat4& projectionView, bool transparent, bool weighted = false);
+	bool			drawWeighted(const std::vector<Layer*>& layers, const glm::mat4& projectionView);
+	void			drawGrids(const Layer& layer, const glm::mat4& projectionView);
+	void			drawSegments(const Layer& layer, const glm::mat4& projectionView);
+
+	void			drawText(const Layer& layer, const glm::mat4& projectionView);
+	void			bindGlyphs(unsigned int base);
+	void			drawCurves(const Layer& layer, const glm::mat4& projectionView);
+	void			addCurve(const glm::vec3* points, unsigned int segments, const glm::vec4& colour);
+
+	void			addSegment(const glm::vec3& start, const glm::vec3& end, const glm::vec4& colour,
+							   float width, float dashLength, float headSize);
+	bool			hasTransparent(const Layer& layer);
+
+	void			addComputeShape(PatchType type, const glm::mat4& transform, float a0, float a1, float b0, float b1,
+									unsigned int rows, unsigned int cols, unsigned int flags,
+									const glm::vec4& colour, const glm::vec4& lineColour,
+									const glm::vec3& boundsCenter, float boundsRadius);
+	void			uploadComputeBatch(ComputeBatch& batch, unsigned int usage);
+	void			expandComputeBatch(const ComputeBatch& batch, const glm::mat4& projectionView);
+	void			drawComputeRegion(const ComputeBatch& batch, unsigned int region, unsigned int mode);
+
+	// the frame layer and every other thread's layer, then the groups ready to draw
+	void			getFrameLayers(std::vector<Layer*>& layers);
+	void			getGroupLayers(std::vector<Layer*>& layers);
+
+	// the layer add* calls on this thread write to, either its frame layer or a group being built
+	Layer*			getLayer();
+
+	bool			isCulled(const glm::vec3& center, float radius);
+	unsigned int	getSegments(const glm::vec3& center, float radius, unsigned int segments, float angle = 6.28318531f);
+
+	// sin and cos pairs around a circle, cached per segment count
+	const float*	getCircle(unsigned int segments);
+
+	unsigned int	m_instanceShader;
+
+	unsigned int	m_gridShader;
+	unsigned int	m_gridVAO;
+
+	unsigned int	m_segmentShader;
+	unsigned int	m_segmentVAO;
+
+	unsigned int	m_curveShader;
+	unsigned int	m_curveVAO;
+
+	unsigned int	m_textShader;
+	unsigned int	m_textVAO;
+	Font*			m_font;
+
+	std::map<unsigned long long, UnitMesh*>	m_unitMeshes;
+	std::mutex		m_meshMutex;
+
+	// the creating thread uses the frame layer, other threads get their own the first time they add
+	Layer			m_frameLayer;
+	std::vector<Layer*>	m_threadLayers;
+	std::mutex		m_threadMutex;
+
+	std::map<unsigned int, Layer*>	m_groups;
+	unsigned int	m_nextGroup;
+	std::mutex		m_groupMutex;
+
+	// a thread's layers are only valid for the Gizmos of the same generation.
+	// the thread's own layer is abandoned when the thread exits
+	struct ThreadLayers {
+		unsigned int	generation;
+		Layer*			frame;
+		Layer*			current;
+
+		~ThreadLayers();
+	};
+
+	static thread_local ThreadLayers	sm_threadLayers;
+	static unsigned int	sm_generation;
+
+	// frustum planes point inwards, and the pixel scale is per world unit at a distance of 1
+	bool			m_hasCamera;
+	float			m_frustum[6][4];
+	float			m_cameraPosition[3];
+	float			m_pixelScale;
+	bool			m_perspective;
+	float			m_tolerance;
+
+	float			m_pointSize;
+
+	// accumulation and revealage targets for order-independent transparency, sized to the viewport
+	unsigned int	m_weightedShader;
+	unsigned int	m_weightedInstanceShader;
+	unsigned int	m_resolveShader;
+	bool			m_weightedTransparency;
+	unsigned int	m_weightedFBO;
+	unsigned int	m_weightedTargets[2];
+	unsigned int	m_weightedDepth;
+	int				m_weightedWidth;
+	int				m_weightedHeight;
+
+	// 0 when compute shaders aren't supported
+	unsigned int	m_computeShader;
+	bool			m_computeTessellation;
+
+	// 20 bytes, with the time the primitive expires
+	struct TimedVertex {
+		float			x, y, z;
+		unsigned char	r, g, b, a;
+		float			expiry;
+	};
+
+	// timed primitives in the order they were added, mirroring the GPU buffer.
+	// the capacity is a multiple of the primitive's vertices so none wrap around
+	struct TimedRing {
+		std::vector<TimedVertex>	vertices;
+		std::vector<TimedVertex>	pending;
+		unsigned int	verticesPerPrimitive;
+		unsigned int	tail;
+		unsigned int	count;
+		unsigned int	vao;
+		unsigned int	vbo;
+	};
+
+	void			initTimedRing(TimedRing& ring, unsigned int verticesPerPrimitive);
+	void			destroyTimedRing(TimedRing& ring);
+	void			addTimed(TimedRing& ring, const glm::vec3* positions, const glm::vec4& colour, float duration);
+	void			updateTimedRing(TimedRing& ring, float time);
+	void			drawTimedRing(const TimedRing& ring, unsigned int mode);
+
+	// seconds since create()
+	float			getTime() const;
+
+	unsigned int	m_timedShader;
+	TimedRing		m_timedLines;
+	TimedRing		m_timedTris;
+	std::mutex		m_timedMutex;
+
+	std::chrono::steady_clock::time_point	m_startTime;
+
+	std::map<unsigned int, std::vector<float>>	m_circles;
+	std::mutex		m_circleMutex;
 
-	unsigned int	m_2DlineVAO;
-	unsigned int 	m_2DlineVBO;
+	// add calls check their thread's channel against the enabled mask first
+	static bool		isChannelActive();
 
-	// 2D triangle data
-	unsigned int	m_max2DTris;
-	unsigned int	m_2DtriCount;
-	GizmoTri*		m_2Dtris;
+	std::vector<std::string>	m_channelNames;
+	std::mutex		m_channelMutex;
+	std::atomic<unsigned long long>	m_channelMask;
 
-	unsigned int	m_2DtriVAO;
-	unsigned int 	m_2DtriVBO;
+	static thread_local unsigned int	sm_channel;
 
 	static Gizmos*	sm_singleton;
 };
@@ -0,0 +1,229 @@
+#include "gl_core_4_4.h"
+#include <GLFW/glfw3.h>
+#include "Lighting2D.h"
+#include "RenderTarget.h"
+#include "ShaderProgram.h"
+#include <glm/ext.hpp>
+
+namespace aie {
+
+Lighting2D::Lighting2D(unsigned int resolutionDivisor)
+	: m_resolutionDivisor(resolutionDivisor > 0 ? resolutionDivisor : 1),
+	m_lightBuffer(new RenderTarget()),
+	m_failedWidth(0),
+	m_failedHeight(0),
+	m_cameraX(0),
+	m_cameraY(0),
+	m_lightHeight(64),
+	m_normalBuffer(0),
+	m_lightBufferSize(0) {
+
+	setAmbientColour(0.1f, 0.1f, 0.1f);
+
+	// each light is a quad expanded from its centre and radius,
+	// with the corner passed through so the fragment shader knows how far from the centre it is
+	const char* lightVS = "#version 150\n \
+					in vec2 corner; \
+					in vec4 light; \
+					in vec4 colour; \
+					out vec2 vCorner; \
+					out vec4 vColour; \
+					out float vRadius; \
+					uniform mat4 projectionMatrix; \
+					void main() { vCorner = corner; vColour = colour; vRadius = light.z; \
+					vColour.rgb *= light.w; \
+					gl_Position = projectionMatrix * vec4(light.xy + corner * light.z, 0, 1); }";
+
+	const char* lightFS = "#version 150\n \
+					in vec2 vCorner; \
+					in vec4 vColour; \
+					in float vRadius; \
+					out vec4 fragColour; \
+					uniform sampler2D normalBuffer; \
+					uniform int useNormals; \
+					uniform vec2 bufferSize; \
+					void main() { \
+						float falloff = clamp(1 - length(vCorner), 0, 1); \
+						vec3 light = vColour.rgb * falloff * falloff; \
+						if (useNormals == 1) { \
+							vec3 N = texture(normalBuffer, gl_FragCoord.xy / bufferSize).xyz * 2 - 1; \
+							vec3 L = normalize(vec3(-vCorner * vRadius, vColour.a)); \
+							light *= max(dot(normalize(N), L), 0); \
+						} \
+						fragColour = vec4(light, 1); }";
+
+	// a single triangle that covers the screen
+	const char* compositeVS = "#version 150\n \
+					out vec2 vTexCoord; \
+					void main() { vTexCoord = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2); \
+					gl_Position = vec4(vTexCoord * 2 - 1, 0, 1); }";
+
+	const char* compositeFS = "#version 150\n \
+					in vec2 vTexCoord; \
+					out vec4 fragColour; \
+					uniform sampler2D lightBuffer; \
+					void main() { fragColour = vec4(texture(lightBuffer, vTexCoord).rgb, 1); }";
+
+	m_lightShader = createShaderProgram(lightVS, lightFS, "Lighting2D");
+	m_compositeShader = createShaderProgram(compositeVS, compositeFS, "Lighting2D composite");
+
+	glUseProgram(m_lightShader);
+	glUniform1i(glGetUniformLocation(m_lightShader, "normalBuffer"), 0);
+	glUseProgram(m_compositeShader);
+	glUniform1i(glGetUniformLocation(m_compositeShader, "lightBuffer"), 0);
+	glUseProgram(0);
+
+	float corners[8] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+
+	glGenVertexArrays(1, &m_lightVAO);
+	glBindVertexArray(m_lightVAO);
+
+	glGenBuffers(1, &m_cornerVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_cornerVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(glGetAttribLocation(m_lightShader, "corner"));
+	glVertexAttribPointer(glGetAttribLocation(m_lightShader, "corner"), 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, 0);
+
+	// per-light data steps once per instance
+	glGenBuffers(1, &m_lightVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_lightVBO);
+	unsigned int lightAttribute = glGetAttribLocation(m_lightShader, "light");
+	unsigned int colourAttribute = glGetAttribLocation(m_lightShader, "colour");
+	glEnableVertexAttribArray(lightAttribute);
+	glEnableVertexAttribArray(colourAttribute);
+	glVertexAttribPointer(lightAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(Light), 0);
+	glVertexAttribPointer(colourAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(Light), (void*)16);
+	glVertexAttribDivisor(lightAttribute, 1);
+	glVertexAttribDivisor(colourAttribute, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenVertexArrays(1, &m_compositeVAO);
+}
+
+Lighting2D::~Lighting2D() {
+	delete m_lightBuffer;
+	glDeleteBuffers(1, &m_lightVBO);
+	glDeleteBuffers(1, &m_cornerVBO);
+	glDeleteVertexArrays(1, &m_lightVAO);
+	glDeleteVertexArrays(1, &m_compositeVAO);
+	glDeleteProgram(m_lightShader);
+	glDeleteProgram(m_compositeShader);
+}
+
+void Lighting2D::setAmbientColour(float r, float g, float b) {
+	m_ambient[0] = r;
+	m_ambient[1] = g;
+	m_ambient[2] = b;
+}
+
+void Lighting2D::addPointLight(float xPos, float yPos, float radius,
+							   float r, float g, float b, float intensity) {
+	Light light = { xPos, yPos, radius, intensity, r, g, b, m_lightHeight };
+	m_lights.push_back(light);
+}
+
+void Lighting2D::clear() {
+	m_lights.clear();
+}
+
+void Lighting2D::draw() {
+
+	int width = 0, height = 0;
+	glfwGetWindowSize(glfwGetCurrentContext(), &width, &height);
+	if (width == 0 || height == 0)
+		return;
+
+	unsigned int bufferWidth = glm::max(width / (int)m_resolutionDivisor, 1);
+	unsigned int bufferHeight = glm::max(height / (int)m_resolutionDivisor, 1);
+
+	// lighting is skipped until the size changes if the buffer can't be created
+	if (bufferWidth == m_failedWidth &&
+		bufferHeight == m_failedHeight)
+		return;
+
+	if (m_lightBuffer->getWidth() != bufferWidth ||
+		m_lightBuffer->getHeight() != bufferHeight) {
+		if (m_lightBuffer->create(bufferWidth, bufferHeight, 1, RenderTarget::RGBA16F) == false) {
+			m_failedWidth = bufferWidth;
+			m_failedHeight = bufferHeight;
+			return;
+		}
+		m_failedWidth = 0;
+		m_failedHeight = 0;
+	}
+
+	// not ideal to store these, but Lighting2D must work stand-alone
+	int shader = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &shader);
+	GLboolean blendEnabled = glIsEnabled(GL_BLEND);
+	GLboolean depthEnabled = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean cullEnabled = glIsEnabled(GL_CULL_FACE);
+	int src, dst;
+	glGetIntegerv(GL_BLEND_SRC, &src);
+	glGetIntegerv(GL_BLEND_DST, &dst);
+
+	glEnable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+
+	// accumulate the lights on top of the ambient colour
+	m_lightBuffer->bind();
+	float ambient[4] = { m_ambient[0], m_ambient[1], m_ambient[2], 1 };
+	glClearBufferfv(GL_COLOR, 0, ambient);
+
+	if (m_lights.empty() == false) {
+
+		// grow the light buffer if needed, otherwise orphan it
+		unsigned int size = (unsigned int)(m_lights.size() * sizeof(Light));
+		glBindBuffer(GL_ARRAY_BUFFER, m_lightVBO);
+		if (size > m_lightBufferSize)
+			m_lightBufferSize = size * 2;
+		glBufferData(GL_ARRAY_BUFFER, m_lightBufferSize, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_lights.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glUseProgram(m_lightShader);
+
+		auto projection = glm::ortho(m_cameraX, m_cameraX + (float)width, m_cameraY, m_cameraY + (float)height);
+		glUniformMatrix4fv(glGetUniformLocation(m_lightShader, "projectionMatrix"), 1, false, &projection[0][0]);
+		glUniform2f(glGetUniformLocation(m_lightShader, "bufferSize"), (float)bufferWidth, (float)bufferHeight);
+		glUniform1i(glGetUniformLocation(m_lightShader, "useNormals"), m_normalBuffer != 0 ? 1 : 0);
+
+		if (m_normalBuffer != 0) {
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, m_normalBuffer);
+		}
+
+		glBlendFunc(GL_ONE, GL_ONE);
+
+		glBindVertexArray(m_lightVAO);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (int)m_lights.size());
+	}
+
+	m_lightBuffer->unbind();
+
+	// multiply the scene by the light
+	glUseProgram(m_compositeShader);
+	m_lightBuffer->bindTarget(0, 0);
+	glBlendFunc(GL_DST_COLOR, GL_ZERO);
+
+	glBindVertexArray(m_compositeVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	// reset state
+	glBlendFunc(src, dst);
+	if (blendEnabled == GL_FALSE)
+		glDisable(GL_BLEND);
+	if (depthEnabled == GL_TRUE)
+		glEnable(GL_DEPTH_TEST);
+	if (cullEnabled == GL_TRUE)
+		glEnable(GL_CULL_FACE);
+	glUseProgram(shader);
+
+	m_lights.clear();
+}
+
+} // namespace aie
\ No newline at end of file
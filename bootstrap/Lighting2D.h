@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+namespace aie {
+
+class RenderTarget;
+
+// a class for lighting 2D scenes with many point lights.
+// lights are drawn as instanced quads into a reduced resolution light buffer
+// in a single draw call, which is then multiplied over whatever has already been
+// drawn to the screen (i.e. by a Renderer2D)
+class Lighting2D {
+public:
+
+	// the light buffer is the window size divided by resolutionDivisor
+	Lighting2D(unsigned int resolutionDivisor = 2);
+	virtual ~Lighting2D();
+
+	// light applied everywhere, even where there are no lights
+	void setAmbientColour(float r, float g, float b);
+
+	// specify the camera position, this should match the Renderer2D camera
+	void setCameraPos(float x, float y) { m_cameraX = x; m_cameraY = y; }
+	void getCameraPos(float& x, float& y) const { x = m_cameraX; y = m_cameraY; }
+
+	// optionally set a window-sized texture containing sprite normals (i.e. sprites drawn
+	// with normal-map textures into a RenderTarget), packed into the 0-1 range.
+	// when set, lights are shaded by how much each pixel faces them. use 0 to disable
+	void setNormalBuffer(unsigned int textureHandle) { m_normalBuffer = textureHandle; }
+
+	// how far above the scene lights are when lighting normals, in pixels
+	void setLightHeight(float height) { m_lightHeight = height; }
+
+	// adds a point light for this frame, with a soft falloff to zero at the radius
+	void addPointLight(float xPos, float yPos, float radius,
+					   float r, float g, float b, float intensity = 1.0f);
+
+	// removes all lights
+	void clear();
+
+	// draws the lights into the light buffer and multiplies it over the currently bound framebuffer.
+	// lights are cleared afterwards
+	void draw();
+
+	unsigned int getLightCount() const { return (unsigned int)m_lights.size(); }
+
+protected:
+
+	struct Light {
+		float x, y, radius, intensity;
+		float r, g, b, height;
+	};
+
+	std::vector<Light>	m_lights;
+
+	unsigned int	m_resolutionDivisor;
+	RenderTarget*	m_lightBuffer;
+
+	// a size the light buffer couldn't be created at, so it isn't tried again every frame
+	unsigned int	m_failedWidth, m_failedHeight;
+
+	float			m_ambient[3];
+	float			m_cameraX, m_cameraY;
+	float			m_lightHeight;
+	unsigned int	m_normalBuffer;
+
+	// instanced light quads
+	unsigned int	m_lightVAO, m_lightVBO, m_cornerVBO;
+	unsigned int	m_lightBufferSize;
+	unsigned int	m_lightShader;
+
+	// full-screen composite
+	unsigned int	m_compositeVAO;
+	unsigned int	m_compositeShader;
+};
+
+} // namespace aie
\ No newline at end of file
@@ -0,0 +1,526 @@
+#include "Path.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <float.h>
+
+namespace aie {
+
+unsigned int Path::sm_nextID = 1;
+
+Path::Path()
+	: m_id(sm_nextID++),
+	m_version(0) {
+}
+
+Path::Path(const Path& other)
+	: m_id(sm_nextID++),
+	m_version(0),
+	m_commands(other.m_commands),
+	m_points(other.m_points) {
+}
+
+Path& Path::operator = (const Path& other) {
+	if (this != &other) {
+		m_commands = other.m_commands;
+		m_points = other.m_points;
+		m_version++;
+	}
+	return *this;
+}
+
+Path::~Path() {
+}
+
+void Path::clear() {
+	m_commands.clear();
+	m_points.clear();
+	m_version++;
+}
+
+void Path::moveTo(float x, float y) {
+	m_commands.push_back(MOVE_TO);
+	m_points.push_back(x);
+	m_points.push_back(y);
+	m_version++;
+}
+
+void Path::lineTo(float x, float y) {
+	m_commands.push_back(LINE_TO);
+	m_points.push_back(x);
+	m_points.push_back(y);
+	m_version++;
+}
+
+void Path::quadTo(float cx, float cy, float x, float y) {
+	m_commands.push_back(QUAD_TO);
+	m_points.push_back(cx);
+	m_points.push_back(cy);
+	m_points.push_back(x);
+	m_points.push_back(y);
+	m_version++;
+}
+
+void Path::cubicTo(float c0x, float c0y, float c1x, float c1y, float x, float y) {
+	m_commands.push_back(CUBIC_TO);
+	m_points.push_back(c0x);
+	m_points.push_back(c0y);
+	m_points.push_back(c1x);
+	m_points.push_back(c1y);
+	m_points.push_back(x);
+	m_points.push_back(y);
+	m_version++;
+}
+
+void Path::close() {
+	m_commands.push_back(CLOSE);
+	m_version++;
+}
+
+// adds a point to a contour, skipping points that are on top of the previous one
+static void addPoint(std::vector<float>& points, const glm::vec2& p) {
+	size_t count = points.size();
+	if (count >= 2 &&
+		glm::abs(points[count - 2] - p.x) < 1e-5f &&
+		glm::abs(points[count - 1] - p.y) < 1e-5f)
+		return;
+	points.push_back(p.x);
+	points.push_back(p.y);
+}
+
+void Path::flatten(float tolerance, std::vector<Contour>& contours) const {
+
+	contours.clear();
+
+	tolerance = glm::max(tolerance, 0.0001f);
+
+	glm::vec2 current(0), start(0);
+	Contour* contour = nullptr;
+	const float* p = m_points.data();
+
+	for (auto command : m_commands) {
+
+		// curves and lines without a move start a new sub-path at the current point
+		if (command != MOVE_TO && command != CLOSE && contour == nullptr) {
+			contours.push_back(Contour());
+			contour = &contours.back();
+			contour->closed = false;
+			start = current;
+			addPoint(contour->points, current);
+		}
+
+		switch (command) {
+		case MOVE_TO:
+			contours.push_back(Contour());
+			contour = &contours.back();
+			contour->closed = false;
+			current = start = glm::vec2(p[0], p[1]);
+			addPoint(contour->points, current);
+			p += 2;
+			break;
+		case LINE_TO:
+			current = glm::vec2(p[0], p[1]);
+			addPoint(contour->points, current);
+			p += 2;
+			break;
+		case QUAD_TO: {
+			glm::vec2 c(p[0], p[1]), end(p[2], p[3]);
+
+			// the flattening error for n segments is roughly |p0 - 2c + p1| / (8n^2)
+			float dd = glm::length(current - 2.0f * c + end);
+			int segments = glm::clamp((int)glm::ceil(glm::sqrt(dd / (8.0f * tolerance))), 1, 256);
+
+			for (int i = 1; i <= segments; ++i) {
+				float t = i / (float)segments;
+				float it = 1.0f - t;
+				addPoint(contour->points, it * it * current + 2.0f * it * t * c + t * t * end);
+			}
+
+			current = end;
+			p += 4;
+			break;
+		}
+		case CUBIC_TO: {
+			glm::vec2 c0(p[0], p[1]), c1(p[2], p[3]), end(p[4], p[5]);
+
+			float dd = glm::max(glm::length(current - 2.0f * c0 + c1), glm::length(c0 - 2.0f * c1 + end));
+			int segments = glm::clamp((int)glm::ceil(glm::sqrt(3.0f * dd / (4.0f * tolerance))), 1, 256);
+
+			for (int i = 1; i <= segments; ++i) {
+				float t = i / (float)segments;
+				float it = 1.0f - t;
+				addPoint(contour->points, it * it * it * current + 3.0f * it * it * t * c0 + 3.0f * it * t * t * c1 + t * t * t * end);
+			}
+
+			current = end;
+			p += 6;
+			break;
+		}
+		case CLOSE:
+			if (contour != nullptr) {
+				contour->closed = true;
+				contour = nullptr;
+			}
+			current = start;
+			break;
+		};
+	}
+
+	// remove the duplicate end point of closed contours, and anything too small to draw
+	for (size_t i = 0; i < contours.size(); ) {
+		auto& points = contours[i].points;
+		size_t count = points.size();
+		if (count >= 4 &&
+			glm::abs(points[0] - points[count - 2]) < 1e-5f &&
+			glm::abs(points[1] - points[count - 1]) < 1e-5f) {
+			points.resize(count - 2);
+			contours[i].closed = true;
+		}
+
+		if (points.size() < 4)
+			contours.erase(contours.begin() + i);
+		else
+			++i;
+	}
+}
+
+// signed area of a polygon, positive if counter-clockwise
+static float signedArea(const std::vector<glm::vec2>& points, const std::vector<unsigned int>& polygon) {
+	float area = 0;
+	size_t count = polygon.size();
+	for (size_t i = 0, j = count - 1; i < count; j = i++) {
+		const glm::vec2& a = points[polygon[j]];
+		const glm::vec2& b = points[polygon[i]];
+		area += a.x * b.y - b.x * a.y;
+	}
+	return area * 0.5f;
+}
+
+static bool pointInPolygon(const glm::vec2& p, const std::vector<glm::vec2>& points, const std::vector<unsigned int>& polygon) {
+	bool inside = false;
+	size_t count = polygon.size();
+	for (size_t i = 0, j = count - 1; i < count; j = i++) {
+		const glm::vec2& a = points[polygon[i]];
+		const glm::vec2& b = points[polygon[j]];
+		if ((a.y > p.y) != (b.y > p.y) &&
+			p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+			inside = !inside;
+	}
+	return inside;
+}
+
+static float cross(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) {
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+// true if segments ab and cd cross, not counting shared end points
+static bool segmentsCross(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d) {
+	if (a == c || a == d || b == c || b == d)
+		return false;
+	float d1 = cross(a, b, c);
+	float d2 = cross(a, b, d);
+	float d3 = cross(c, d, a);
+	float d4 = cross(c, d, b);
+	return ((d1 > 0) != (d2 > 0)) && ((d3 > 0) != (d4 > 0));
+}
+
+// joins a hole into an outer polygon with a pair of bridge edges so it can be ear clipped as one polygon
+static void bridgeHole(const std::vector<glm::vec2>& points, std::vector<unsigned int>& outer,
+					   const std::vector<unsigned int>& hole, const std::vector<std::vector<unsigned int>>& otherHoles) {
+
+	// start from the right-most hole vertex
+	size_t holeStart = 0;
+	for (size_t i = 1; i < hole.size(); ++i) {
+		if (points[hole[i]].x > points[hole[holeStart]].x)
+			holeStart = i;
+	}
+	const glm::vec2& m = points[hole[holeStart]];
+
+	// find the closest outer vertex that can see it without crossing an edge
+	size_t best = outer.size();
+	float bestDistance = 0;
+	for (size_t i = 0; i < outer.size(); ++i) {
+		const glm::vec2& v = points[outer[i]];
+		float distance = glm::dot(v - m, v - m);
+		if (best != outer.size() && distance >= bestDistance)
+			continue;
+
+		bool visible = true;
+		for (size_t j = 0, k = outer.size() - 1; j < outer.size() && visible; k = j++)
+			visible = !segmentsCross(m, v, points[outer[k]], points[outer[j]]);
+		for (size_t j = 0, k = hole.size() - 1; j < hole.size() && visible; k = j++)
+			visible = !segmentsCross(m, v, points[hole[k]], points[hole[j]]);
+		for (size_t h = 0; h < otherHoles.size() && visible; ++h) {
+			auto& other = otherHoles[h];
+			for (size_t j = 0, k = other.size() - 1; j < other.size() && visible; k = j++)
+				visible = !segmentsCross(m, v, points[other[k]], points[other[j]]);
+		}
+
+		if (visible) {
+			best = i;
+			bestDistance = distance;
+		}
+	}
+
+	if (best == outer.size())
+		return;
+
+	// outer up to v, the whole hole starting and ending at m, then back to v
+	std::vector<unsigned int> merged;
+	merged.reserve(outer.size() + hole.size() + 2);
+	merged.insert(merged.end(), outer.begin(), outer.begin() + best + 1);
+	for (size_t i = 0; i <= hole.size(); ++i)
+		merged.push_back(hole[(holeStart + i) % hole.size()]);
+	merged.insert(merged.end(), outer.begin() + best, outer.end());
+
+	outer.swap(merged);
+}
+
+// triangulates a counter-clockwise polygon that may touch itself along bridge edges
+static void earClip(const std::vector<glm::vec2>& points, std::vector<unsigned int> polygon, std::vector<unsigned short>& indices) {
+
+	while (polygon.size() > 3) {
+
+		size_t count = polygon.size();
+		bool clipped = false;
+
+		for (size_t i = 0; i < count && !clipped; ++i) {
+			unsigned int ia = polygon[(i + count - 1) % count];
+			unsigned int ib = polygon[i];
+			unsigned int ic = polygon[(i + 1) % count];
+			const glm::vec2& a = points[ia];
+			const glm::vec2& b = points[ib];
+			const glm::vec2& c = points[ic];
+
+			// reflex or flat corners can't be ears
+			if (cross(a, b, c) <= 0)
+				continue;
+
+			// no other vertex may be inside the ear
+			bool ear = true;
+			for (size_t j = 0; j < count && ear; ++j) {
+				const glm::vec2& p = points[polygon[j]];
+				if (p == a || p == b || p == c)
+					continue;
+				ear = !(cross(a, b, p) >= 0 && cross(b, c, p) >= 0 && cross(c, a, p) >= 0);
+			}
+
+			if (ear) {
+				indices.push_back((unsigned short)ia);
+				indices.push_back((unsigned short)ib);
+				indices.push_back((unsigned short)ic);
+				polygon.erase(polygon.begin() + i);
+				clipped = true;
+			}
+		}
+
+		// the polygon is degenerate or self-intersecting, drop a flat corner if there is one
+		// otherwise clip whatever is left so that at least something is drawn
+		if (clipped == false) {
+			size_t flattest = 0;
+			float smallest = FLT_MAX;
+			for (size_t i = 0; i < count; ++i) {
+				float area = glm::abs(cross(points[polygon[(i + count - 1) % count]], points[polygon[i]], points[polygon[(i + 1) % count]]));
+				if (area < smallest) {
+					smallest = area;
+					flattest = i;
+				}
+			}
+
+			if (smallest > 1e-6f) {
+				indices.push_back((unsigned short)polygon[(flattest + count - 1) % count]);
+				indices.push_back((unsigned short)polygon[flattest]);
+				indices.push_back((unsigned short)polygon[(flattest + 1) % count]);
+			}
+			polygon.erase(polygon.begin() + flattest);
+		}
+	}
+
+	if (polygon.size() == 3 &&
+		cross(points[polygon[0]], points[polygon[1]], points[polygon[2]]) > 0) {
+		indices.push_back((unsigned short)polygon[0]);
+		indices.push_back((unsigned short)polygon[1]);
+		indices.push_back((unsigned short)polygon[2]);
+	}
+}
+
+void Path::tessellateFill(float tolerance, std::vector<float>& vertices, std::vector<unsigned short>& indices) const {
+
+	vertices.clear();
+	indices.clear();
+
+	std::vector<Contour> contours;
+	flatten(tolerance, contours);
+
+	// gather all points, every contour is filled as if it were closed
+	std::vector<glm::vec2> points;
+	std::vector<std::vector<unsigned int>> polygons(contours.size());
+	for (size_t i = 0; i < contours.size(); ++i) {
+		auto& contour = contours[i].points;
+		for (size_t j = 0; j < contour.size(); j += 2) {
+			polygons[i].push_back((unsigned int)points.size());
+			points.push_back(glm::vec2(contour[j], contour[j + 1]));
+		}
+	}
+
+	if (points.size() > 0xFFFF)
+		return;
+
+	// work out which contours are holes by how deeply they are nested
+	std::vector<int> parent(polygons.size(), -1);
+	std::vector<int> depth(polygons.size(), 0);
+	std::vector<float> area(polygons.size());
+	for (size_t i = 0; i < polygons.size(); ++i)
+		area[i] = signedArea(points, polygons[i]);
+
+	for (size_t i = 0; i < polygons.size(); ++i) {
+		for (size_t j = 0; j < polygons.size(); ++j) {
+			if (i == j ||
+				glm::abs(area[j]) <= glm::abs(area[i]) ||
+				pointInPolygon(points[polygons[i][0]], points, polygons[j]) == false)
+				continue;
+
+			depth[i]++;
+			if (parent[i] == -1 || glm::abs(area[j]) < glm::abs(area[parent[i]]))
+				parent[i] = (int)j;
+		}
+	}
+
+	// outer contours wind counter-clockwise and holes clockwise
+	for (size_t i = 0; i < polygons.size(); ++i) {
+		bool hole = (depth[i] & 1) != 0;
+		if ((area[i] > 0) == hole)
+			std::reverse(polygons[i].begin(), polygons[i].end());
+	}
+
+	for (size_t i = 0; i < polygons.size(); ++i) {
+		if (depth[i] & 1)
+			continue;
+
+		// bridge in the holes from right to left so that the bridges don't cross
+		std::vector<std::vector<unsigned int>> holes;
+		for (size_t j = 0; j < polygons.size(); ++j) {
+			if (parent[j] == (int)i && (depth[j] & 1))
+				holes.push_back(polygons[j]);
+		}
+
+		std::sort(holes.begin(), holes.end(), [&points](const std::vector<unsigned int>& a, const std::vector<unsigned int>& b) {
+			float ax = -FLT_MAX, bx = -FLT_MAX;
+			for (auto index : a) ax = glm::max(ax, points[index].x);
+			for (auto index : b) bx = glm::max(bx, points[index].x);
+			return ax > bx;
+		});
+
+		std::vector<unsigned int> outer = polygons[i];
+		while (holes.empty() == false) {
+			std::vector<unsigned int> hole = holes.front();
+			holes.erase(holes.begin());
+			bridgeHole(points, outer, hole, holes);
+		}
+
+		earClip(points, outer, indices);
+	}
+
+	vertices.reserve(points.size() * 2);
+	for (auto& p : points) {
+		vertices.push_back(p.x);
+		vertices.push_back(p.y);
+	}
+}
+
+void Path::tessellateStroke(float tolerance, float thickness, std::vector<float>& vertices, std::vector<unsigned short>& indices) const {
+
+	vertices.clear();
+	indices.clear();
+
+	std::vector<Contour> contours;
+	flatten(tolerance, contours);
+
+	float halfWidth = thickness * 0.5f;
+
+	// mitres longer than this turn into bevels
+	const float miterLimit = 4.0f;
+
+	for (auto& contour : contours) {
+
+		int count = (int)contour.points.size() / 2;
+		bool closed = contour.closed && count > 2;
+
+		if (vertices.size() / 2 + count * 5 > 0xFFFF)
+			break;
+
+		auto point = [&contour, count](int i) {
+			i = (i + count) % count;
+			return glm::vec2(contour.points[i * 2], contour.points[i * 2 + 1]);
+		};
+
+		// each point gets a left / right pair to end the incoming segment
+		// and a pair to start the outgoing segment, which are shared for mitred joins
+		unsigned short firstIn = 0, previousOut = 0;
+
+		for (int i = 0; i < count; ++i) {
+
+			glm::vec2 p = point(i);
+			bool hasIn = closed || i > 0;
+			bool hasOut = closed || i < count - 1;
+
+			glm::vec2 dirIn = hasIn ? glm::normalize(p - point(i - 1)) : glm::normalize(point(i + 1) - p);
+			glm::vec2 dirOut = hasOut ? glm::normalize(point(i + 1) - p) : dirIn;
+			glm::vec2 normalIn(-dirIn.y, dirIn.x);
+			glm::vec2 normalOut(-dirOut.y, dirOut.x);
+
+			unsigned short in = (unsigned short)(vertices.size() / 2);
+			unsigned short out = in;
+
+			glm::vec2 miter = normalIn + normalOut;
+			float miterLength = glm::length(miter);
+			float scale = miterLength > 1e-4f ? 2.0f / (miterLength * miterLength) : 0.0f;
+
+			if (miterLength > 1e-4f && scale * miterLength <= miterLimit) {
+
+				// mitre, the offset is scaled so that both edges stay the same width
+				glm::vec2 offset = miter * scale * halfWidth;
+				vertices.push_back(p.x + offset.x);	vertices.push_back(p.y + offset.y);
+				vertices.push_back(p.x - offset.x);	vertices.push_back(p.y - offset.y);
+			}
+			else {
+
+				// bevel, with a triangle to fill the gap on the outside of the corner
+				glm::vec2 inOffset = normalIn * halfWidth;
+				glm::vec2 outOffset = normalOut * halfWidth;
+				vertices.push_back(p.x + inOffset.x);	vertices.push_back(p.y + inOffset.y);
+				vertices.push_back(p.x - inOffset.x);	vertices.push_back(p.y - inOffset.y);
+				vertices.push_back(p.x + outOffset.x);	vertices.push_back(p.y + outOffset.y);
+				vertices.push_back(p.x - outOffset.x);	vertices.push_back(p.y - outOffset.y);
+				vertices.push_back(p.x);				vertices.push_back(p.y);
+
+				out = in + 2;
+				unsigned short centre = in + 4;
+
+				// the outside of the corner is on the right when turning left
+				if (dirIn.x * dirOut.y - dirIn.y * dirOut.x > 0) {
+					indices.push_back(centre);	indices.push_back(in + 1);	indices.push_back(out + 1);
+				}
+				else {
+					indices.push_back(centre);	indices.push_back(out);	indices.push_back(in);
+				}
+			}
+
+			if (i == 0)
+				firstIn = in;
+			else {
+				indices.push_back(previousOut);	indices.push_back(previousOut + 1);	indices.push_back(in + 1);
+				indices.push_back(previousOut);	indices.push_back(in + 1);	indices.push_back(in);
+			}
+
+			previousOut = out;
+		}
+
+		// join the last point back to the first
+		if (closed) {
+			indices.push_back(previousOut);	indices.push_back(previousOut + 1);	indices.push_back(firstIn + 1);
+			indices.push_back(previousOut);	indices.push_back(firstIn + 1);	indices.push_back(firstIn);
+		}
+	}
+}
+
+} // namespace aie
\ No newline at end of file
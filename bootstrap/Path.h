@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+namespace aie {
+
+// a 2D vector shape made of straight lines and bezier curves, similar to an SVG path.
+// paths are drawn with Renderer2D::drawPath / strokePath which cache the tessellated
+// triangles, so a path that doesn't change is only tessellated once
+class Path {
+public:
+
+	Path();
+	~Path();
+
+	// copies get their own id, so they're cached separately from the original
+	Path(const Path& other);
+	Path& operator = (const Path& other);
+
+	// removes all commands
+	void clear();
+
+	// starts a new sub-path at the given point
+	void moveTo(float x, float y);
+
+	// adds a straight line from the current point
+	void lineTo(float x, float y);
+
+	// adds a quadratic bezier curve from the current point using one control point
+	void quadTo(float cx, float cy, float x, float y);
+
+	// adds a cubic bezier curve from the current point using two control points
+	void cubicTo(float c0x, float c0y, float c1x, float c1y, float x, float y);
+
+	// joins the current sub-path back to its start
+	void close();
+
+	// the id is unique to each path, and the version changes each time the path is edited
+	unsigned int getID() const { return m_id; }
+	unsigned int getVersion() const { return m_version; }
+
+	bool isEmpty() const { return m_commands.empty(); }
+
+	// tessellates the inside of the path into triangles, with vertices as x,y pairs.
+	// sub-paths inside other sub-paths are treated as holes (even-odd nesting).
+	// tolerance is the maximum distance the curves may stray from the real shape
+	void tessellateFill(float tolerance, std::vector<float>& vertices, std::vector<unsigned short>& indices) const;
+
+	// tessellates the outline of the path into triangles with a given thickness,
+	// using mitred joins that fall back to bevels on sharp corners
+	void tessellateStroke(float tolerance, float thickness, std::vector<float>& vertices, std::vector<unsigned short>& indices) const;
+
+protected:
+
+	enum Command : unsigned char {
+		MOVE_TO,
+		LINE_TO,
+		QUAD_TO,
+		CUBIC_TO,
+		CLOSE,
+	};
+
+	// a flattened sub-path
+	struct Contour {
+		std::vector<float>	points;
+		bool				closed;
+	};
+
+	void flatten(float tolerance, std::vector<Contour>& contours) const;
+
+	unsigned int				m_id;
+	unsigned int				m_version;
+
+	std::vector<Command>		m_commands;
+	std::vector<float>			m_points;
+
+	static unsigned int			sm_nextID;
+};
+
+} // namespace aie
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include "gl_core_4_4.h"
+#include "PostProcess.h"
+#include "RenderTarget.h"
+#include "ShaderProgram.h"
+
+namespace aie {
+
+// a single triangle that covers the screen
+static const char* sm_vertexSource = "#version 150\n \
+				out vec2 vTexCoord; \
+				void main() { vTexCoord = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2); \
+				gl_Position = vec4(vTexCoord * 2 - 1, 0, 1); }";
+
+// inputs shared by every pass
+static const char* sm_fragmentHeader = "#version 150\n \
+				in vec2 vTexCoord; \
+				out vec4 fragColour; \
+				uniform sampler2D sourceTexture; \
+				uniform sampler2D sceneTexture; \
+				uniform vec2 texelSize; \n";
+
+// every pass shares the full-screen triangle and the names of its textures
+static unsigned int createProgram(const std::string& fragmentSource, const char* name) {
+
+	std::string programName = std::string("PostProcess \"") + name + "\"";
+	unsigned int program = createShaderProgram(sm_vertexSource, fragmentSource.c_str(), programName.c_str());
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "sourceTexture"), 0);
+	glUniform1i(glGetUniformLocation(program, "sceneTexture"), 1);
+	glUseProgram(0);
+
+	return program;
+}
+
+PostProcess::PostProcess()
+	: m_sceneTarget(new RenderTarget()),
+	m_begun(false),
+	m_previousFramebuffer(0),
+	m_stageCount(0) {
+
+	glGenVertexArrays(1, &m_vao);
+
+	m_copyProgram = createProgram(std::string(sm_fragmentHeader) +
+								  "void main() { fragColour = texture(sourceTexture, vTexCoord); }", "copy");
+}
+
+PostProcess::~PostProcess() {
+	for (auto& pass : m_passes) {
+		if (pass.program != 0)
+			glDeleteProgram(pass.program);
+	}
+	for (auto& program : m_mergedPrograms)
+		glDeleteProgram(program.second);
+	for (auto& pooled : m_targetPool)
+		delete pooled.target;
+
+	delete m_sceneTarget;
+	glDeleteProgram(m_copyProgram);
+	glDeleteVertexArrays(1, &m_vao);
+}
+
+unsigned int PostProcess::addPass(const char* name, const char* fragmentSource, Resolution resolution) {
+
+	Pass pass;
+	pass.name = name;
+	pass.source = fragmentSource;
+	pass.colourPass = false;
+	pass.resolution = resolution;
+	pass.enabled = true;
+	pass.params[0] = pass.params[1] = pass.params[2] = pass.params[3] = 0;
+	pass.program = createProgram(std::string(sm_fragmentHeader) + "uniform vec4 params;\n" + fragmentSource, name);
+
+	m_passes.push_back(pass);
+	return (unsigned int)m_passes.size() - 1;
+}
+
+unsigned int PostProcess::addColourPass(const char* name, const char* functionBody, Resolution resolution) {
+
+	Pass pass;
+	pass.name = name;
+	pass.source = functionBody;
+	pass.colourPass = true;
+	pass.resolution = resolution;
+	pass.enabled = true;
+	pass.params[0] = pass.params[1] = pass.params[2] = pass.params[3] = 0;
+	pass.program = 0;
+
+	m_passes.push_back(pass);
+	return (unsigned int)m_passes.size() - 1;
+}
+
+int PostProcess::findPass(const char* name) const {
+	for (size_t i = 0; i < m_passes.size(); ++i) {
+		if (m_passes[i].name == name)
+			return (int)i;
+	}
+	return -1;
+}
+
+void PostProcess::setPassEnabled(unsigned int pass, bool enabled) {
+	if (pass < m_passes.size())
+		m_passes[pass].enabled = enabled;
+}
+
+bool PostProcess::isPassEnabled(unsigned int pass) const {
+	return pass < m_passes.size() && m_passes[pass].enabled;
+}
+
+void PostProcess::setPassParams(unsigned int pass, float x, float y, float z, float w) {
+	if (pass < m_passes.size()) {
+		m_passes[pass].params[0] = x;
+		m_passes[pass].params[1] = y;
+		m_passes[pass].params[2] = z;
+		m_passes[pass].params[3] = w;
+	}
+}
+
+void PostProcess::begin() {
+
+	if (m_begun)
+		return;
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_viewport);
+
+	unsigned int width = m_viewport[2];
+	unsigned int height = m_viewport[3];
+
+	if (m_sceneTarget->getWidth() != width ||
+		m_sceneTarget->getHeight() != height) {
+		m_sceneTarget->create(width, height, 1, RenderTarget::RGBA16F, true);
+
+		// drop pooled targets sized for the old viewport
+		for (auto& pooled : m_targetPool)
+			delete pooled.target;
+		m_targetPool.clear();
+	}
+
+	m_sceneTarget->bind();
+	m_begun = true;
+}
+
+void PostProcess::end() {
+
+	if (m_begun == false)
+		return;
+
+	m_sceneTarget->unbind();
+	m_begun = false;
+
+	// group the enabled passes into stages, merging neighbouring colour passes at the same resolution
+	std::vector<Stage> stages;
+	std::vector<unsigned int> enabledPasses;
+	for (unsigned int i = 0; i < m_passes.size(); ++i) {
+		if (m_passes[i].enabled)
+			enabledPasses.push_back(i);
+	}
+
+	for (size_t i = 0; i < enabledPasses.size(); ) {
+		const Pass& pass = m_passes[enabledPasses[i]];
+
+		Stage stage = { (unsigned int)i, 1, pass.resolution };
+		if (pass.colourPass) {
+			while (i + stage.passCount < enabledPasses.size() &&
+				   m_passes[enabledPasses[i + stage.passCount]].colourPass &&
+				   m_passes[enabledPasses[i + stage.passCount]].resolution == pass.resolution)
+				stage.passCount++;
+		}
+
+		i += stage.passCount;
+		stages.push_back(stage);
+	}
+
+	// stages refer to passes through the enabled list
+	for (auto& stage : stages) {
+		stage.firstPass = enabledPasses[stage.firstPass];
+	}
+
+	m_stageCount = (unsigned int)stages.size();
+
+	// not ideal to store these, but PostProcess must work stand-alone
+	int shader = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &shader);
+	GLboolean blendEnabled = glIsEnabled(GL_BLEND);
+	GLboolean depthEnabled = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean cullEnabled = glIsEnabled(GL_CULL_FACE);
+
+	glDisable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+
+	glBindVertexArray(m_vao);
+
+	m_sceneTarget->bindTarget(0, 1);
+
+	unsigned int source = m_sceneTarget->getTargetHandle(0);
+	unsigned int sourceWidth = m_sceneTarget->getWidth();
+	unsigned int sourceHeight = m_sceneTarget->getHeight();
+	RenderTarget* sourceTarget = nullptr;
+
+	unsigned int fullWidth = m_viewport[2];
+	unsigned int fullHeight = m_viewport[3];
+
+	for (size_t i = 0; i < stages.size(); ++i) {
+		const Stage& stage = stages[i];
+
+		unsigned int program = getStageProgram(stage);
+
+		// the last full resolution stage can draw straight to the output
+		bool last = i == stages.size() - 1;
+		if (last && stage.resolution == FULL) {
+			glBindFramebuffer(GL_FRAMEBUFFER, m_previousFramebuffer);
+			glViewport(m_viewport[0], m_viewport[1], m_viewport[2], m_viewport[3]);
+			drawStage(stage, program, source, sourceWidth, sourceHeight);
+			releaseTarget(sourceTarget);
+			sourceTarget = nullptr;
+			source = 0;
+			break;
+		}
+
+		RenderTarget* target = acquireTarget(fullWidth / stage.resolution > 0 ? fullWidth / stage.resolution : 1,
+											 fullHeight / stage.resolution > 0 ? fullHeight / stage.resolution : 1);
+		target->bind();
+		drawStage(stage, program, source, sourceWidth, sourceHeight);
+		target->unbind();
+
+		releaseTarget(sourceTarget);
+		sourceTarget = target;
+		source = target->getTargetHandle(0);
+		sourceWidth = target->getWidth();
+		sourceHeight = target->getHeight();
+	}
+
+	// copy (and scale up if needed) whatever is left to the output
+	if (source != 0) {
+		glBindFramebuffer(GL_FRAMEBUFFER, m_previousFramebuffer);
+		glViewport(m_viewport[0], m_viewport[1], m_viewport[2], m_viewport[3]);
+
+		glUseProgram(m_copyProgram);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, source);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		releaseTarget(sourceTarget);
+	}
+
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+
+	// reset state
+	if (blendEnabled == GL_TRUE)
+		glEnable(GL_BLEND);
+	if (depthEnabled == GL_TRUE)
+		glEnable(GL_DEPTH_TEST);
+	if (cullEnabled == GL_TRUE)
+		glEnable(GL_CULL_FACE);
+	glUseProgram(shader);
+}
+
+unsigned int PostProcess::getStageProgram(const Stage& stage) {
+
+	const Pass& first = m_passes[stage.firstPass];
+	if (first.colourPass == false)
+		return first.program;
+
+	// the key lists the merged passes, i.e. "2,3,5"
+	std::string key;
+	std::vector<unsigned int> passes;
+	for (unsigned int i = stage.firstPass; passes.size() < stage.passCount; ++i) {
+		if (m_passes[i].enabled == false)
+			continue;
+		passes.push_back(i);
+		key += std::to_string(i) + ",";
+	}
+
+	auto iter = m_mergedPrograms.find(key);
+	if (iter != m_mergedPrograms.end())
+		return iter->second;
+
+	// each pass becomes its own function with its own params uniform
+	std::string source = sm_fragmentHeader;
+	for (auto index : passes) {
+		std::string id = std::to_string(index);
+		source += "uniform vec4 params_" + id + ";\n";
+		source += "#define params params_" + id + "\n";
+		source += "vec4 effect_" + id + "(vec4 colour, vec2 uv) {\n" + m_passes[index].source + "\n}\n";
+		source += "#undef params\n";
+	}
+
+	source += "void main() {\n vec4 colour = texture(sourceTexture, vTexCoord);\n";
+	for (auto index : passes)
+		source += " colour = effect_" + std::to_string(index) + "(colour, vTexCoord);\n";
+	source += " fragColour = colour;\n}\n";
+
+	unsigned int program = createProgram(source, key.c_str());
+	m_mergedPrograms[key] = program;
+	return program;
+}
+
+void PostProcess::drawStage(const Stage& stage, unsigned int program,
+							unsigned int sourceTexture, unsigned int sourceWidth, unsigned int sourceHeight) {
+
+	glUseProgram(program);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, sourceTexture);
+
+	glUniform2f(glGetUniformLocation(program, "texelSize"), 1.0f / sourceWidth, 1.0f / sourceHeight);
+
+	const Pass& first = m_passes[stage.firstPass];
+	if (first.colourPass) {
+		unsigned int count = 0;
+		for (unsigned int i = stage.firstPass; count < stage.passCount; ++i) {
+			if (m_passes[i].enabled == false)
+				continue;
+			std::string uniform = "params_" + std::to_string(i);
+			glUniform4fv(glGetUniformLocation(program, uniform.c_str()), 1, m_passes[i].params);
+			count++;
+		}
+	}
+	else
+		glUniform4fv(glGetUniformLocation(program, "params"), 1, first.params);
+
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+RenderTarget* PostProcess::acquireTarget(unsigned int width, unsigned int height) {
+
+	for (auto& pooled : m_targetPool) {
+		if (pooled.inUse == false &&
+			pooled.target->getWidth() == width &&
+			pooled.target->getHeight() == height) {
+			pooled.inUse = true;
+			return pooled.target;
+		}
+	}
+
+	PooledTarget pooled = { new RenderTarget(width, height, 1, RenderTarget::RGBA16F), true };
+	m_targetPool.push_back(pooled);
+	return pooled.target;
+}
+
+void PostProcess::releaseTarget(RenderTarget* target) {
+	for (auto& pooled : m_targetPool) {
+		if (pooled.target == target)
+			pooled.inUse = false;
+	}
+}
+
+} // namespace aie
\ No newline at end of file
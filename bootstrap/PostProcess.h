@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+
+namespace aie {
+
+class RenderTarget;
+
+// a chain of full-screen passes (i.e. bloom, blur, colour grading) applied to everything
+// drawn between begin() and end().
+// intermediate targets are pooled and reused by size, and each pass can run at full,
+// half or quarter resolution so its cost stays predictable as the window grows.
+// disabled passes are skipped, and neighbouring colour passes are merged into one shader
+class PostProcess {
+public:
+
+	enum Resolution : unsigned int {
+		FULL	= 1,
+		HALF	= 2,
+		QUARTER	= 4,
+	};
+
+	PostProcess();
+	virtual ~PostProcess();
+
+	// adds a pass from the body of a fragment shader that defines main().
+	// the shader is given vTexCoord, sourceTexture (the previous pass), sceneTexture (the original image),
+	// texelSize (of the source texture) and params (set with setPassParams), and must write fragColour.
+	// returns an id for the pass
+	unsigned int addPass(const char* name, const char* fragmentSource, Resolution resolution = FULL);
+
+	// adds a per-pixel pass given as the body of a function "vec4 effect(vec4 colour, vec2 uv)"
+	// that returns the new colour, with params available as for addPass.
+	// colour passes that follow each other at the same resolution are run as a single shader
+	unsigned int addColourPass(const char* name, const char* functionBody, Resolution resolution = FULL);
+
+	// returns the id of a pass by name, or -1 if not found
+	int findPass(const char* name) const;
+
+	void setPassEnabled(unsigned int pass, bool enabled);
+	bool isPassEnabled(unsigned int pass) const;
+
+	// sets the params uniform for a pass
+	void setPassParams(unsigned int pass, float x, float y = 0, float z = 0, float w = 0);
+
+	// redirects drawing into the scene target, which covers the current viewport
+	void begin();
+
+	// runs the enabled passes and draws the result to the framebuffer that was bound at begin()
+	void end();
+
+	// the number of shader passes the last end() ran, after merging
+	unsigned int getStageCount() const { return m_stageCount; }
+
+protected:
+
+	struct Pass {
+		std::string		name;
+		std::string		source;
+		bool			colourPass;
+		Resolution		resolution;
+		bool			enabled;
+		float			params[4];
+		unsigned int	program;
+	};
+
+	// a run of passes drawn with one shader
+	struct Stage {
+		unsigned int	firstPass;
+		unsigned int	passCount;
+		Resolution		resolution;
+	};
+
+	unsigned int getStageProgram(const Stage& stage);
+	void drawStage(const Stage& stage, unsigned int program, unsigned int sourceTexture, unsigned int sourceWidth, unsigned int sourceHeight);
+
+	RenderTarget* acquireTarget(unsigned int width, unsigned int height);
+	void releaseTarget(RenderTarget* target);
+
+	std::vector<Pass>	m_passes;
+
+	// shaders for merged colour passes, keyed by the pass ids they contain
+	std::map<std::string, unsigned int>	m_mergedPrograms;
+
+	struct PooledTarget {
+		RenderTarget*	target;
+		bool			inUse;
+	};
+
+	std::vector<PooledTarget>	m_targetPool;
+
+	RenderTarget*	m_sceneTarget;
+	bool			m_begun;
+
+	int				m_previousFramebuffer;
+	int				m_viewport[4];
+
+	unsigned int	m_vao;
+	unsigned int	m_copyProgram;
+	unsigned int	m_stageCount;
+};
+
+} // namespace aie
\ No newline at end of file
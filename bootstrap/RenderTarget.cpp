@@ -0,0 +1,137 @@
+#include "gl_core_4_4.h"
+#include "RenderTarget.h"
+#include <stdio.h>
+
+namespace aie {
+
+RenderTarget::RenderTarget()
+	: m_width(0),
+	m_height(0),
+	m_format(RGBA8),
+	m_targetCount(0),
+	m_fbo(0),
+	m_depth(0),
+	m_previousFramebuffer(0) {
+
+	for (int i = 0; i < MAX_TARGETS; ++i)
+		m_targets[i] = 0;
+}
+
+RenderTarget::RenderTarget(unsigned int width, unsigned int height, unsigned int targetCount, Format format, bool depth)
+	: m_width(0),
+	m_height(0),
+	m_format(format),
+	m_targetCount(0),
+	m_fbo(0),
+	m_depth(0),
+	m_previousFramebuffer(0) {
+
+	for (int i = 0; i < MAX_TARGETS; ++i)
+		m_targets[i] = 0;
+
+	create(width, height, targetCount, format, depth);
+}
+
+RenderTarget::~RenderTarget() {
+	destroy();
+}
+
+bool RenderTarget::create(unsigned int width, unsigned int height, unsigned int targetCount, Format format, bool depth) {
+
+	destroy();
+
+	// the framebuffer bound by the caller is put back afterwards
+	int previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	if (targetCount > MAX_TARGETS)
+		targetCount = MAX_TARGETS;
+
+	m_width = width;
+	m_height = height;
+	m_format = format;
+	m_targetCount = targetCount;
+
+	glGenFramebuffers(1, &m_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+	unsigned int drawBuffers[MAX_TARGETS];
+
+	glGenTextures(m_targetCount, m_targets);
+	for (unsigned int i = 0; i < m_targetCount; ++i) {
+		glBindTexture(GL_TEXTURE_2D, m_targets[i]);
+
+		if (m_format == RGBA16F)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_width, m_height, 0, GL_RGBA, GL_FLOAT, nullptr);
+		else
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_targets[i], 0);
+		drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glDrawBuffers(m_targetCount, drawBuffers);
+
+	if (depth) {
+		glGenRenderbuffers(1, &m_depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	}
+
+	unsigned int status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		printf("Error: Failed to create RenderTarget! (0x%x)\n", status);
+		destroy();
+		return false;
+	}
+
+	return true;
+}
+
+void RenderTarget::destroy() {
+	if (m_targetCount > 0)
+		glDeleteTextures(m_targetCount, m_targets);
+	if (m_depth != 0)
+		glDeleteRenderbuffers(1, &m_depth);
+	if (m_fbo != 0)
+		glDeleteFramebuffers(1, &m_fbo);
+
+	for (int i = 0; i < MAX_TARGETS; ++i)
+		m_targets[i] = 0;
+
+	m_fbo = 0;
+	m_depth = 0;
+	m_targetCount = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+void RenderTarget::bind() {
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	glViewport(0, 0, m_width, m_height);
+}
+
+void RenderTarget::unbind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, m_previousFramebuffer);
+	glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+}
+
+void RenderTarget::bindTarget(unsigned int target, unsigned int slot) const {
+	glActiveTexture(GL_TEXTURE0 + slot);
+	glBindTexture(GL_TEXTURE_2D, getTargetHandle(target));
+}
+
+} // namespace aie
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+namespace aie {
+
+// a class for wrapping up an opengl framebuffer with one or more colour textures
+// that can be drawn into and then sampled like any other texture
+class RenderTarget {
+public:
+
+	enum Format : unsigned int {
+		RGBA8 = 0,
+		RGBA16F,
+	};
+
+	RenderTarget();
+	RenderTarget(unsigned int width, unsigned int height, unsigned int targetCount = 1, Format format = RGBA8, bool depth = false);
+	virtual ~RenderTarget();
+
+	// creates the framebuffer and its textures, releasing any previous ones
+	bool create(unsigned int width, unsigned int height, unsigned int targetCount = 1, Format format = RGBA8, bool depth = false);
+
+	// binds the framebuffer and sets the viewport to cover it,
+	// unbind restores the framebuffer and viewport that were bound before
+	void bind();
+	void unbind();
+
+	// binds one of the colour textures to the specified slot
+	void bindTarget(unsigned int target, unsigned int slot) const;
+
+	unsigned int getWidth() const { return m_width; }
+	unsigned int getHeight() const { return m_height; }
+	unsigned int getFormat() const { return m_format; }
+	unsigned int getTargetCount() const { return m_targetCount; }
+
+	// returns the opengl handles
+	unsigned int getFramebufferHandle() const { return m_fbo; }
+	unsigned int getTargetHandle(unsigned int target) const { return target < m_targetCount ? m_targets[target] : 0; }
+
+protected:
+
+	void destroy();
+
+	enum { MAX_TARGETS = 8 };
+
+	unsigned int	m_width;
+	unsigned int	m_height;
+	unsigned int	m_format;
+	unsigned int	m_targetCount;
+
+	unsigned int	m_fbo;
+	unsigned int	m_targets[MAX_TARGETS];
+	unsigned int	m_depth;
+
+	// state to restore on unbind
+	int				m_previousFramebuffer;
+	int				m_previousViewport[4];
+};
+
+} // namespace aie
\ No newline at end of file
@@ -3,8 +3,10 @@
 #include "Renderer2D.h"
 #include "Texture.h"
 #include "Font.h"
+#include "Path.h"
 #include <glm/ext.hpp>
 #include <stb_truetype.h>
+#include <string.h>
 
 namespace aie {
 
@@ -22,6 +24,8 @@ Renderer2D::Renderer2D() {
 	m_currentVertex = 0;
 	m_currentIndex = 0;
 	m_renderBegun = false;
+	m_sortedLayerBegun = false;
+	m_frame = 0;
 
 	m_vao = -1;
 	m_vbo = -1;
@@ -151,6 +155,16 @@ void Renderer2D::begin() {
 	m_currentVertex = 0;
 	m_currentTexture = 0;
 
+	// release cached paths that haven't been drawn for a while
+	if ((++m_frame % 64) == 0) {
+		for (auto iter = m_pathCache.begin(); iter != m_pathCache.end(); ) {
+			if (m_frame - iter->second.lastUsedFrame > 300)
+				iter = m_pathCache.erase(iter);
+			else
+				++iter;
+		}
+	}
+
 	int width = 0, height = 0;
 	auto window = glfwGetCurrentContext();
 	glfwGetWindowSize(window, &width, &height);
@@ -170,6 +184,9 @@ void Renderer2D::end() {
 	if (m_renderBegun == false)
 		return;
 
+	if (m_sortedLayerBegun)
+		endSortedLayer();
+
 	flushBatch();
 
 	glUseProgram(0);
@@ -177,6 +194,167 @@ void Renderer2D::end() {
 	m_renderBegun = false;
 }
 
+void Renderer2D::beginSortedLayer() {
+	if (m_sortedLayerBegun)
+		return;
+
+	m_sortedLayerBegun = true;
+	m_sortedSprites.clear();
+}
+
+void Renderer2D::endSortedLayer() {
+	if (m_sortedLayerBegun == false)
+		return;
+
+	m_sortedLayerBegun = false;
+
+	sortLayer();
+
+	for (auto index : m_sortOrder)
+		drawSortedSprite(index);
+
+	// keep the memory around for the next frame
+	m_sortedSprites.clear();
+}
+
+void Renderer2D::recordSortedSprite(Texture* texture, float sortY, const float* corners, float depth) {
+
+	SortedSprite sprite;
+	sprite.texture = texture;
+	memcpy(sprite.corners, corners, sizeof(float) * 8);
+	sprite.depth = depth;
+	sprite.colour[0] = m_r;
+	sprite.colour[1] = m_g;
+	sprite.colour[2] = m_b;
+	sprite.colour[3] = m_a;
+	sprite.uvRect[0] = m_uvX;
+	sprite.uvRect[1] = m_uvY;
+	sprite.uvRect[2] = m_uvW;
+	sprite.uvRect[3] = m_uvH;
+
+	// flip the float bits so that they sort as unsigned integers,
+	// then invert so that the highest y is drawn first
+	unsigned int bits = 0;
+	memcpy(&bits, &sortY, sizeof(unsigned int));
+	bits = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+	sprite.sortKey = ~bits;
+
+	m_sortedSprites.push_back(sprite);
+}
+
+void Renderer2D::sortLayer() {
+
+	unsigned int count = (unsigned int)m_sortedSprites.size();
+	unsigned int previousCount = (unsigned int)m_sortOrder.size();
+
+	// start from last frame's order, dropping sprites that are no longer drawn
+	// and appending new ones on the end
+	if (count < previousCount) {
+		unsigned int kept = 0;
+		for (unsigned int i = 0; i < previousCount; ++i) {
+			if (m_sortOrder[i] < count)
+				m_sortOrder[kept++] = m_sortOrder[i];
+		}
+		m_sortOrder.resize(kept);
+	}
+	else {
+		for (unsigned int i = previousCount; i < count; ++i)
+			m_sortOrder.push_back(i);
+	}
+
+	// measure how far out of order the sprites are
+	unsigned int descents = 0;
+	for (unsigned int i = 1; i < count; ++i) {
+		if (m_sortedSprites[m_sortOrder[i - 1]].sortKey > m_sortedSprites[m_sortOrder[i]].sortKey)
+			descents++;
+	}
+
+	if (descents == 0)
+		return;
+
+	if (descents <= count / 32 + 8) {
+
+		// nearly sorted, so an insertion sort only moves the few sprites that changed
+		for (unsigned int i = 1; i < count; ++i) {
+			unsigned int index = m_sortOrder[i];
+			unsigned int key = m_sortedSprites[index].sortKey;
+			unsigned int j = i;
+			while (j > 0 && m_sortedSprites[m_sortOrder[j - 1]].sortKey > key) {
+				m_sortOrder[j] = m_sortOrder[j - 1];
+				j--;
+			}
+			m_sortOrder[j] = index;
+		}
+	}
+	else {
+
+		// otherwise a stable 8-bit radix sort, skipping bytes that are the same for every key
+		m_sortScratch.resize(count);
+
+		for (unsigned int shift = 0; shift < 32; shift += 8) {
+
+			unsigned int histogram[256] = {};
+			for (unsigned int i = 0; i < count; ++i)
+				histogram[(m_sortedSprites[m_sortOrder[i]].sortKey >> shift) & 0xFF]++;
+
+			if (histogram[(m_sortedSprites[m_sortOrder[0]].sortKey >> shift) & 0xFF] == count)
+				continue;
+
+			unsigned int offset = 0;
+			for (unsigned int i = 0; i < 256; ++i) {
+				unsigned int bucket = histogram[i];
+				histogram[i] = offset;
+				offset += bucket;
+			}
+
+			for (unsigned int i = 0; i < count; ++i) {
+				unsigned int index = m_sortOrder[i];
+				m_sortScratch[histogram[(m_sortedSprites[index].sortKey >> shift) & 0xFF]++] = index;
+			}
+
+			m_sortOrder.swap(m_sortScratch);
+		}
+	}
+}
+
+void Renderer2D::drawSortedSprite(unsigned int index) {
+
+	const SortedSprite& sprite = m_sortedSprites[index];
+
+	if (shouldFlush())
+		flushBatch();
+	unsigned int textureID = pushTexture(sprite.texture);
+
+	// texture coordinates for the tl, tr, br and bl corners
+	float uvX0 = sprite.uvRect[0], uvX1 = sprite.uvRect[0] + sprite.uvRect[2];
+	float uvY0 = sprite.uvRect[1], uvY1 = sprite.uvRect[1] + sprite.uvRect[3];
+	float texcoords[8] = { uvX0, uvY1, uvX1, uvY1, uvX1, uvY0, uvX0, uvY0 };
+
+	int vertex = m_currentVertex;
+
+	for (int i = 0; i < 4; ++i) {
+		m_vertices[m_currentVertex].pos[0] = sprite.corners[i * 2 + 0];
+		m_vertices[m_currentVertex].pos[1] = sprite.corners[i * 2 + 1];
+		m_vertices[m_currentVertex].pos[2] = sprite.depth;
+		m_vertices[m_currentVertex].pos[3] = (float)textureID;
+		m_vertices[m_currentVertex].color[0] = sprite.colour[0];
+		m_vertices[m_currentVertex].color[1] = sprite.colour[1];
+		m_vertices[m_currentVertex].color[2] = sprite.colour[2];
+		m_vertices[m_currentVertex].color[3] = sprite.colour[3];
+		m_vertices[m_currentVertex].texcoord[0] = texcoords[i * 2 + 0];
+		m_vertices[m_currentVertex].texcoord[1] = texcoords[i * 2 + 1];
+		m_currentVertex++;
+	}
+
+	m_indices[m_currentIndex++] = (vertex + 0);
+	m_indices[m_currentIndex++] = (vertex + 2);
+	m_indices[m_currentIndex++] = (vertex + 3);
+
+	m_indices[m_currentIndex++] = (vertex + 0);
+	m_indices[m_currentIndex++] = (vertex + 1);
+	m_indices[m_currentIndex++] = (vertex + 2);
+}
+
 void Renderer2D::drawBox(float xPos, float yPos, float width, float height, float rotation, float depth) {
 	drawSprite(nullptr, xPos, yPos, width, height, rotation, depth);
 }
@@ -242,10 +420,6 @@ void Renderer2D::drawSprite(Texture * texture,
 	if (texture == nullptr)
 		texture = m_nullTexture;
 
-	if (shouldFlush())
-		flushBatch();
-	unsigned int textureID = pushTexture(texture);
-
 	if (width == 0.0f)
 		width = (float)texture->getWidth();
 	if (height == 0.0f)
@@ -264,6 +438,17 @@ void Renderer2D::drawSprite(Texture * texture,
 		rotateAround(blX, blY, blX, blY, si, co);
 	}
 
+	if (m_sortedLayerBegun) {
+		float corners[8] = { xPos + tlX, yPos + tlY, xPos + trX, yPos + trY,
+							 xPos + brX, yPos + brY, xPos + blX, yPos + blY };
+		recordSortedSprite(texture, yPos, corners, depth);
+		return;
+	}
+
+	if (shouldFlush())
+		flushBatch();
+	unsigned int textureID = pushTexture(texture);
+
 	int index = m_currentVertex;
 
 	m_vertices[m_currentVertex].pos[0] = xPos + tlX;
@@ -330,11 +515,6 @@ void Renderer2D::drawSpriteTransformed3x3(Texture * texture,
 	if (texture == nullptr)
 		texture = m_nullTexture;
 
-	if (shouldFlush())
-		flushBatch();
-
-	unsigned int textureID = pushTexture(texture);
-
 	if (width == 0.0f)
 		width = (float)texture->getWidth();
 	if (height == 0.0f)
@@ -363,6 +543,17 @@ void Renderer2D::drawSpriteTransformed3x3(Texture * texture,
 	blX = x * transformMat3x3[0] + y * transformMat3x3[3] + transformMat3x3[6];
 	blY = x * transformMat3x3[1] + y * transformMat3x3[4] + transformMat3x3[7];	
 
+	if (m_sortedLayerBegun) {
+		float corners[8] = { tlX, tlY, trX, trY, brX, brY, blX, blY };
+		recordSortedSprite(texture, transformMat3x3[7], corners, depth);
+		return;
+	}
+
+	if (shouldFlush())
+		flushBatch();
+
+	unsigned int textureID = pushTexture(texture);
+
 	int index = m_currentVertex;
 	
 	m_vertices[m_currentVertex].pos[0] = tlX;
@@ -429,10 +620,6 @@ void Renderer2D::drawSpriteTransformed4x4(Texture * texture,
 	if (texture == nullptr)
 		texture = m_nullTexture;
 
-	if (shouldFlush())
-		flushBatch();
-	unsigned int textureID = pushTexture(texture);
-
 	if (width == 0.0f)
 		width = (float)texture->getWidth();
 	if (height == 0.0f)
@@ -462,6 +649,16 @@ void Renderer2D::drawSpriteTransformed4x4(Texture * texture,
 	blX = x * transformMat4x4[0] + y * transformMat4x4[4] + transformMat4x4[12];
 	blY = x * transformMat4x4[1] + y * transformMat4x4[5] + transformMat4x4[13];
 
+	if (m_sortedLayerBegun) {
+		float corners[8] = { tlX, tlY, trX, trY, brX, brY, blX, blY };
+		recordSortedSprite(texture, transformMat4x4[13], corners, depth);
+		return;
+	}
+
+	if (shouldFlush())
+		flushBatch();
+	unsigned int textureID = pushTexture(texture);
+
 	int index = m_currentVertex;
 
 	m_vertices[m_currentVertex].pos[0] = tlX;
@@ -521,6 +718,293 @@ void Renderer2D::drawSpriteTransformed4x4(Texture * texture,
 	m_indices[m_currentIndex++] = (index + 2);
 }
 
+void Renderer2D::drawNineSlice(Texture* texture,
+								float xPos, float yPos, float width, float height,
+								float left, float right, float top, float bottom,
+								float rotation, float depth, float xOrigin, float yOrigin) {
+	if (texture == nullptr)
+		texture = m_nullTexture;
+
+	if (shouldFlush(16, 54))
+		flushBatch();
+	unsigned int textureID = pushTexture(texture);
+
+	// shrink the borders if the panel is smaller than them
+	float xScale = (left + right) > width ? width / (left + right) : 1.0f;
+	float yScale = (top + bottom) > height ? height / (top + bottom) : 1.0f;
+
+	// the 4 columns and 4 rows of the grid, bottom to top
+	float x0 = (0.0f - xOrigin) * width;
+	float x3 = (1.0f - xOrigin) * width;
+	float y0 = (0.0f - yOrigin) * height;
+	float y3 = (1.0f - yOrigin) * height;
+	float xs[4] = { x0, x0 + left * xScale, x3 - right * xScale, x3 };
+	float ys[4] = { y0, y0 + bottom * yScale, y3 - top * yScale, y3 };
+
+	float texelW = m_uvW / (float)texture->getWidth();
+	float texelH = m_uvH / (float)texture->getHeight();
+	float us[4] = { m_uvX, m_uvX + left * texelW, m_uvX + m_uvW - right * texelW, m_uvX + m_uvW };
+	float vs[4] = { m_uvY + m_uvH, m_uvY + m_uvH - bottom * texelH, m_uvY + top * texelH, m_uvY };
+
+	float si = glm::sin(rotation); float co = glm::cos(rotation);
+
+	int index = m_currentVertex;
+
+	for (int row = 0; row < 4; ++row) {
+		for (int col = 0; col < 4; ++col) {
+			float x = xs[col], y = ys[row];
+			if (rotation != 0.0f)
+				rotateAround(xs[col], ys[row], x, y, si, co);
+
+			m_vertices[m_currentVertex].pos[0] = xPos + x;
+			m_vertices[m_currentVertex].pos[1] = yPos + y;
+			m_vertices[m_currentVertex].pos[2] = depth;
+			m_vertices[m_currentVertex].pos[3] = (float)textureID;
+			m_vertices[m_currentVertex].color[0] = m_r;
+			m_vertices[m_currentVertex].color[1] = m_g;
+			m_vertices[m_currentVertex].color[2] = m_b;
+			m_vertices[m_currentVertex].color[3] = m_a;
+			m_vertices[m_currentVertex].texcoord[0] = us[col];
+			m_vertices[m_currentVertex].texcoord[1] = vs[row];
+			m_currentVertex++;
+		}
+	}
+
+	for (int row = 0; row < 3; ++row) {
+		for (int col = 0; col < 3; ++col) {
+			int corner = index + row * 4 + col;
+
+			m_indices[m_currentIndex++] = (corner + 0);
+			m_indices[m_currentIndex++] = (corner + 5);
+			m_indices[m_currentIndex++] = (corner + 4);
+
+			m_indices[m_currentIndex++] = (corner + 0);
+			m_indices[m_currentIndex++] = (corner + 1);
+			m_indices[m_currentIndex++] = (corner + 5);
+		}
+	}
+}
+
+void Renderer2D::drawNineSliceTiled(Texture* texture,
+									 float xPos, float yPos, float width, float height,
+									 float left, float right, float top, float bottom,
+									 float rotation, float depth, float xOrigin, float yOrigin) {
+	if (texture == nullptr)
+		texture = m_nullTexture;
+
+	// shrink the borders if the panel is smaller than them
+	float xScale = (left + right) > width ? width / (left + right) : 1.0f;
+	float yScale = (top + bottom) > height ? height / (top + bottom) : 1.0f;
+
+	float x0 = (0.0f - xOrigin) * width;
+	float x3 = (1.0f - xOrigin) * width;
+	float y0 = (0.0f - yOrigin) * height;
+	float y3 = (1.0f - yOrigin) * height;
+	float xs[4] = { x0, x0 + left * xScale, x3 - right * xScale, x3 };
+	float ys[4] = { y0, y0 + bottom * yScale, y3 - top * yScale, y3 };
+
+	float texelW = m_uvW / (float)texture->getWidth();
+	float texelH = m_uvH / (float)texture->getHeight();
+	float us[4] = { m_uvX, m_uvX + left * texelW, m_uvX + m_uvW - right * texelW, m_uvX + m_uvW };
+	float vs[4] = { m_uvY + m_uvH, m_uvY + m_uvH - bottom * texelH, m_uvY + top * texelH, m_uvY };
+
+	// size of one repeat of the centre section in pixels
+	float tileW = (float)texture->getWidth() * m_uvW - left - right;
+	float tileH = (float)texture->getHeight() * m_uvH - top - bottom;
+
+	float si = glm::sin(rotation); float co = glm::cos(rotation);
+
+	unsigned int textureID = pushTexture(texture);
+
+	for (int row = 0; row < 3; ++row) {
+		for (int col = 0; col < 3; ++col) {
+
+			// corners stretch, the edges and centre repeat along the axis that is not a border
+			bool repeatX = col == 1 && tileW > 0;
+			bool repeatY = row == 1 && tileH > 0;
+			float spanX = xs[col + 1] - xs[col];
+			float spanY = ys[row + 1] - ys[row];
+
+			if (spanX <= 0 || spanY <= 0)
+				continue;
+
+			// repeats are at least a pixel, so a tiny centre can't make millions of quads
+			float stepX = repeatX ? glm::max(tileW, 1.0f) : spanX;
+			float stepY = repeatY ? glm::max(tileH, 1.0f) : spanY;
+
+			// the small tolerance stops float error adding a sliver on the end
+			int countX = glm::max(1, (int)glm::ceil((spanX - 0.01f) / stepX));
+			int countY = glm::max(1, (int)glm::ceil((spanY - 0.01f) / stepY));
+
+			for (int tileY = 0; tileY < countY; ++tileY) {
+				float y = ys[row] + tileY * stepY;
+				float yEnd = glm::min(y + stepY, ys[row + 1]);
+
+				// crop the last repeat
+				float v1 = vs[row] + (vs[row + 1] - vs[row]) * (repeatY ? (yEnd - y) / stepY : 1.0f);
+
+				for (int tileX = 0; tileX < countX; ++tileX) {
+					float x = xs[col] + tileX * stepX;
+					float xEnd = glm::min(x + stepX, xs[col + 1]);
+					float u1 = us[col] + (us[col + 1] - us[col]) * (repeatX ? (xEnd - x) / stepX : 1.0f);
+
+					if (shouldFlush(4, 6)) {
+						flushBatch();
+						textureID = pushTexture(texture);
+					}
+
+					float corners[8] = { x, y, xEnd, y, xEnd, yEnd, x, yEnd };
+					float texcoords[8] = { us[col], vs[row], u1, vs[row], u1, v1, us[col], v1 };
+
+					int index = m_currentVertex;
+
+					for (int i = 0; i < 4; ++i) {
+						float cx = corners[i * 2 + 0], cy = corners[i * 2 + 1];
+						if (rotation != 0.0f)
+							rotateAround(corners[i * 2 + 0], corners[i * 2 + 1], cx, cy, si, co);
+
+						m_vertices[m_currentVertex].pos[0] = xPos + cx;
+						m_vertices[m_currentVertex].pos[1] = yPos + cy;
+						m_vertices[m_currentVertex].pos[2] = depth;
+						m_vertices[m_currentVertex].pos[3] = (float)textureID;
+						m_vertices[m_currentVertex].color[0] = m_r;
+						m_vertices[m_currentVertex].color[1] = m_g;
+						m_vertices[m_currentVertex].color[2] = m_b;
+						m_vertices[m_currentVertex].color[3] = m_a;
+						m_vertices[m_currentVertex].texcoord[0] = texcoords[i * 2 + 0];
+						m_vertices[m_currentVertex].texcoord[1] = texcoords[i * 2 + 1];
+						m_currentVertex++;
+					}
+
+					m_indices[m_currentIndex++] = (index + 0);
+					m_indices[m_currentIndex++] = (index + 2);
+					m_indices[m_currentIndex++] = (index + 3);
+
+					m_indices[m_currentIndex++] = (index + 0);
+					m_indices[m_currentIndex++] = (index + 1);
+					m_indices[m_currentIndex++] = (index + 2);
+				}
+			}
+		}
+	}
+}
+
+void Renderer2D::drawPath(Path* path, float xPos, float yPos, float scale, float rotation, float depth) {
+
+	if (path == nullptr || path->isEmpty())
+		return;
+
+	const PathMesh* mesh = getPathMesh(path, scale, 0.0f);
+	drawPathMesh(*mesh, xPos, yPos, scale, rotation, depth);
+}
+
+void Renderer2D::strokePath(Path* path, float xPos, float yPos, float thickness, float scale, float rotation, float depth) {
+
+	if (path == nullptr || path->isEmpty() || thickness <= 0.0f)
+		return;
+
+	const PathMesh* mesh = getPathMesh(path, scale, thickness);
+	drawPathMesh(*mesh, xPos, yPos, scale, rotation, depth);
+}
+
+const Renderer2D::PathMesh* Renderer2D::getPathMesh(Path* path, float scale, float thickness) {
+
+	// scales are grouped into quarter-octave levels so that zooming doesn't tessellate every frame,
+	// and each level is tessellated for its largest scale so curves stay within a quarter pixel
+	int scaleLevel = (int)glm::ceil(glm::log2(glm::max(glm::abs(scale), 0.0001f)) * 4.0f);
+	float tolerance = 0.25f / glm::pow(2.0f, scaleLevel / 4.0f);
+
+	PathKey key = { path->getID(), scaleLevel, thickness };
+
+	auto iter = m_pathCache.find(key);
+	if (iter == m_pathCache.end()) {
+		iter = m_pathCache.insert(std::make_pair(key, PathMesh())).first;
+		iter->second.version = path->getVersion() - 1;
+	}
+
+	PathMesh& mesh = iter->second;
+	mesh.lastUsedFrame = m_frame;
+
+	if (mesh.version != path->getVersion()) {
+		mesh.version = path->getVersion();
+		if (thickness > 0.0f)
+			path->tessellateStroke(tolerance, thickness, mesh.vertices, mesh.indices);
+		else
+			path->tessellateFill(tolerance, mesh.vertices, mesh.indices);
+	}
+
+	return &mesh;
+}
+
+void Renderer2D::drawPathMesh(const PathMesh& mesh, float xPos, float yPos, float scale, float rotation, float depth) {
+
+	int vertexCount = (int)mesh.vertices.size() / 2;
+	int indexCount = (int)mesh.indices.size();
+
+	if (indexCount == 0)
+		return;
+
+	float si = glm::sin(rotation) * scale;
+	float co = glm::cos(rotation) * scale;
+
+	// small meshes are appended to the batch as they are,
+	// meshes too big for a batch are split into separate triangles
+	bool fitsInBatch = vertexCount < (MAX_SPRITES * 4) && indexCount < (MAX_SPRITES * 6);
+
+	if (fitsInBatch && shouldFlush(vertexCount, indexCount))
+		flushBatch();
+	unsigned int textureID = pushTexture(m_nullTexture);
+
+	if (fitsInBatch) {
+		int index = m_currentVertex;
+
+		for (int i = 0; i < vertexCount; ++i) {
+			float x = mesh.vertices[i * 2 + 0];
+			float y = mesh.vertices[i * 2 + 1];
+
+			m_vertices[m_currentVertex].pos[0] = xPos + x * co - y * si;
+			m_vertices[m_currentVertex].pos[1] = yPos + x * si + y * co;
+			m_vertices[m_currentVertex].pos[2] = depth;
+			m_vertices[m_currentVertex].pos[3] = (float)textureID;
+			m_vertices[m_currentVertex].color[0] = m_r;
+			m_vertices[m_currentVertex].color[1] = m_g;
+			m_vertices[m_currentVertex].color[2] = m_b;
+			m_vertices[m_currentVertex].color[3] = m_a;
+			m_vertices[m_currentVertex].texcoord[0] = 0.5f;
+			m_vertices[m_currentVertex].texcoord[1] = 0.5f;
+			m_currentVertex++;
+		}
+
+		for (int i = 0; i < indexCount; ++i)
+			m_indices[m_currentIndex++] = (unsigned short)(index + mesh.indices[i]);
+	}
+	else {
+		for (int i = 0; i < indexCount; ++i) {
+
+			if ((i % 3) == 0 && shouldFlush(3, 3)) {
+				flushBatch();
+				textureID = pushTexture(m_nullTexture);
+			}
+
+			float x = mesh.vertices[mesh.indices[i] * 2 + 0];
+			float y = mesh.vertices[mesh.indices[i] * 2 + 1];
+
+			m_vertices[m_currentVertex].pos[0] = xPos + x * co - y * si;
+			m_vertices[m_currentVertex].pos[1] = yPos + x * si + y * co;
+			m_vertices[m_currentVertex].pos[2] = depth;
+			m_vertices[m_currentVertex].pos[3] = (float)textureID;
+			m_vertices[m_currentVertex].color[0] = m_r;
+			m_vertices[m_currentVertex].color[1] = m_g;
+			m_vertices[m_currentVertex].color[2] = m_b;
+			m_vertices[m_currentVertex].color[3] = m_a;
+			m_vertices[m_currentVertex].texcoord[0] = 0.5f;
+			m_vertices[m_currentVertex].texcoord[1] = 0.5f;
+			m_indices[m_currentIndex++] = (unsigned short)m_currentVertex;
+			m_currentVertex++;
+		}
+	}
+}
+
 void Renderer2D::drawLine(float x1, float y1, float x2, float y2, float thickness, float depth) {
 
 	float xDiff = x2 - x1;
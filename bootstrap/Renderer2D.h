@@ -1,9 +1,13 @@
 #pragma once
 
+#include <vector>
+#include <map>
+
 namespace aie {
 
 class Texture;
 class Font;
+class Path;
 
 // a class for rendering 2D sprites and font
 class Renderer2D {
@@ -16,6 +20,14 @@ public:
 	virtual void begin();
 	virtual void end();
 
+	// sprites, boxes and lines drawn between a beginSortedLayer / endSortedLayer pair are
+	// recorded and drawn when the layer ends, ordered by their y position with the highest
+	// drawn first (i.e. for isometric or top-down scenes).
+	// the order is kept between frames, so a scene that barely moves is only lightly re-sorted.
+	// circles, nine-slices, paths and text are not sorted and are drawn immediately
+	virtual void beginSortedLayer();
+	virtual void endSortedLayer();
+
 	// simple shape rendering
 	virtual void drawBox(float xPos, float yPos, float width, float height, float rotation = 0.0f, float depth = 0.0f);
 	virtual void drawCircle(float xPos, float yPos, float radius, float depth = 0.0f);
@@ -26,6 +38,25 @@ public:
 	virtual void drawSpriteTransformed3x3(Texture* texture, float* transformMat3x3, float width = 0.0f, float height = 0.0f, float depth = 0.0f, float xOrigin = 0.5f, float yOrigin = 0.5f);
 	virtual void drawSpriteTransformed4x4(Texture* texture, float* transformMat4x4, float width = 0.0f, float height = 0.0f, float depth = 0.0f, float xOrigin = 0.5f, float yOrigin = 0.5f);
 
+	// draws a texture stretched over a rectangle while keeping its borders a fixed size, i.e. for UI panels.
+	// borders are in pixels of the texture, and the current UV rect can be used to pick a panel from an atlas.
+	// the 9 quads share 16 vertices and are drawn in a single call
+	virtual void drawNineSlice(Texture* texture, float xPos, float yPos, float width, float height,
+							   float left, float right, float top, float bottom,
+							   float rotation = 0.0f, float depth = 0.0f, float xOrigin = 0.5f, float yOrigin = 0.5f);
+
+	// as drawNineSlice, but the edges and centre repeat the texture rather than stretching it
+	virtual void drawNineSliceTiled(Texture* texture, float xPos, float yPos, float width, float height,
+									float left, float right, float top, float bottom,
+									float rotation = 0.0f, float depth = 0.0f, float xOrigin = 0.5f, float yOrigin = 0.5f);
+
+	// fills a vector path at a position, scale and rotation using the current colour.
+	// the triangles are cached for each path and scale, so a path that doesn't change is cheap to redraw
+	virtual void drawPath(Path* path, float xPos, float yPos, float scale = 1.0f, float rotation = 0.0f, float depth = 0.0f);
+
+	// draws the outline of a vector path, thickness is in the same units as the path
+	virtual void strokePath(Path* path, float xPos, float yPos, float thickness = 1.0f, float scale = 1.0f, float rotation = 0.0f, float depth = 0.0f);
+
 	// draws a simple coloured line with a given thickness
 	// depth is in the range [0,100] with lower being closer to the viewer
 	virtual void drawLine(float x1, float y1, float x2, float y2, float thickness = 1.0f, float depth = 0.0f );
@@ -53,6 +84,34 @@ protected:
 	void flushBatch();
 	unsigned int pushTexture(Texture* texture);
 
+	// records a quad for the current sorted layer, corners are tl, tr, br, bl
+	void recordSortedSprite(Texture* texture, float sortY, const float* corners, float depth);
+	void drawSortedSprite(unsigned int index);
+	void sortLayer();
+
+	// path tessellations are cached per path, scale level and stroke thickness (0 for fills)
+	struct PathKey {
+		unsigned int	pathID;
+		int				scaleLevel;
+		float			thickness;
+
+		bool operator < (const PathKey& rhs) const {
+			if (pathID != rhs.pathID) return pathID < rhs.pathID;
+			if (scaleLevel != rhs.scaleLevel) return scaleLevel < rhs.scaleLevel;
+			return thickness < rhs.thickness;
+		}
+	};
+
+	struct PathMesh {
+		unsigned int				version;
+		unsigned int				lastUsedFrame;
+		std::vector<float>			vertices;
+		std::vector<unsigned short>	indices;
+	};
+
+	const PathMesh* getPathMesh(Path* path, float scale, float thickness);
+	void drawPathMesh(const PathMesh& mesh, float xPos, float yPos, float scale, float rotation, float depth);
+
 	// indicates in the middle of a begin/end pair
 	bool				m_renderBegun;
 
@@ -89,6 +148,27 @@ protected:
 	// shader used to render sprites
 	unsigned int		m_shader;
 
+	// sorted layer handling
+	struct SortedSprite {
+		Texture*	texture;
+		float		corners[8];
+		float		depth;
+		float		colour[4];
+		float		uvRect[4];
+		unsigned int sortKey;
+	};
+
+	bool						m_sortedLayerBegun;
+	std::vector<SortedSprite>	m_sortedSprites;
+
+	// draw order from the previous frame, indexed by submission order
+	std::vector<unsigned int>	m_sortOrder;
+	std::vector<unsigned int>	m_sortScratch;
+
+	// tessellated paths, unused entries are released after a few seconds
+	std::map<PathKey, PathMesh>	m_pathCache;
+	unsigned int				m_frame;
+
 	// helper method used to rotate sprites around a pivot
 	void	rotateAround(float inX, float inY, float& outX, float& outY, float sin, float cos);
 
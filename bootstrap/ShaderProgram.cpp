@@ -0,0 +1,57 @@
+#include "gl_core_4_4.h"
+#include "ShaderProgram.h"
+#include <stdio.h>
+
+namespace aie {
+
+static unsigned int compileShader(unsigned int type, const char* source) {
+	unsigned int shader = glCreateShader(type);
+	glShaderSource(shader, 1, (const char**)&source, 0);
+	glCompileShader(shader);
+	return shader;
+}
+
+// links the shaders, which are released once the program has them
+static unsigned int linkProgram(const unsigned int* shaders, int count, const char* name,
+								void (*bindLocations)(unsigned int program)) {
+
+	unsigned int program = glCreateProgram();
+	for (int i = 0; i < count; ++i)
+		glAttachShader(program, shaders[i]);
+	if (bindLocations != nullptr)
+		bindLocations(program);
+	glLinkProgram(program);
+
+	int success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (success == GL_FALSE) {
+		int infoLogLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+		char* infoLog = new char[infoLogLength + 1];
+
+		glGetProgramInfoLog(program, infoLogLength, 0, infoLog);
+		printf("Error: Failed to link %s shader program!\n%s\n", name, infoLog);
+		delete[] infoLog;
+	}
+
+	for (int i = 0; i < count; ++i)
+		glDeleteShader(shaders[i]);
+
+	return program;
+}
+
+unsigned int createShaderProgram(const char* vsSource, const char* fsSource, const char* name,
+								 void (*bindLocations)(unsigned int program)) {
+
+	unsigned int shaders[] = { compileShader(GL_VERTEX_SHADER, vsSource),
+							   compileShader(GL_FRAGMENT_SHADER, fsSource) };
+	return linkProgram(shaders, 2, name, bindLocations);
+}
+
+unsigned int createComputeShaderProgram(const char* source, const char* name) {
+
+	unsigned int shader = compileShader(GL_COMPUTE_SHADER, source);
+	return linkProgram(&shader, 1, name, nullptr);
+}
+
+} // namespace aie
\ No newline at end of file
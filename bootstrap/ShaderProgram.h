@@ -0,0 +1,14 @@
+#pragma once
+
+namespace aie {
+
+// compiles a vertex / fragment pair and links them into a program, printing the log with the
+// name if linking fails. bindLocations, if given, is called before linking so that attribute
+// and fragment output locations can be bound
+unsigned int createShaderProgram(const char* vsSource, const char* fsSource, const char* name,
+								 void (*bindLocations)(unsigned int program) = nullptr);
+
+// compiles and links a single compute shader in the same way
+unsigned int createComputeShaderProgram(const char* source, const char* name);
+
+} // namespace aie
\ No newline at end of file
@@ -4,15 +4,904 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include <stdio.h>
+#include <ctype.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// S3TC isn't part of core OpenGL, but every desktop driver supports it
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT		0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT	0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT	0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT	0x83F3
+
 namespace aie {
 
+// mip levels ready to upload, either block compressed or plain pixels
+struct ImageLevels {
+	unsigned int	internalFormat;
+
+	// the type is 0 for compressed levels
+	unsigned int	format;
+	unsigned int	type;
+
+	unsigned int	channels;
+	unsigned int	width, height;
+
+	// the unpack alignment of each row of plain pixels
+	unsigned int	alignment;
+
+	// each level's start within the data, followed by the end of the last
+	std::vector<unsigned char>	data;
+	std::vector<size_t>			offsets;
+
+	// levels read from a memory-mapped file are used in place rather than copied to data
+	const unsigned char*		mapped;
+
+	ImageLevels() : alignment(4), mapped(nullptr) {}
+
+	const unsigned char* getData() const { return mapped != nullptr ? mapped : data.data(); }
+	size_t getSize() const { return offsets.empty() ? 0 : offsets.back(); }
+};
+
+// a read-only view of a whole file, paged in by the OS as it's read
+struct MappedFile {
+	const unsigned char*	data;
+	size_t					size;
+
+#ifdef _WIN32
+	HANDLE					file;
+	HANDLE					mapping;
+#endif
+
+	MappedFile();
+	~MappedFile();
+
+	bool open(const char* filename);
+	void close();
+
+	// touches every page so that later reads, such as the driver's copy, don't wait on the disk
+	void prefetch() const;
+};
+
+MappedFile::MappedFile()
+	: data(nullptr),
+	size(0) {
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const char* filename) {
+	close();
+
+#ifdef _WIN32
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+					   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file, &fileSize) == FALSE ||
+		fileSize.QuadPart == 0) {
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping != nullptr)
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	int file = ::open(filename, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) == 0 &&
+		info.st_size > 0) {
+		size = (size_t)info.st_size;
+		void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED) {
+			data = (const unsigned char*)view;
+			madvise(view, size, MADV_SEQUENTIAL);
+		}
+	}
+
+	// the mapping stays valid once the file is closed
+	::close(file);
+#endif
+
+	if (data == nullptr) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+#else
+	if (data != nullptr)
+		munmap((void*)data, size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+void MappedFile::prefetch() const {
+	volatile unsigned char sum = 0;
+	for (size_t i = 0; i < size; i += 4096)
+		sum += data[i];
+}
+
+static inline unsigned int levelSize(unsigned int size, size_t level) {
+	return (size >> level) > 0 ? (size >> level) : 1;
+}
+
+// box filters a level into the next, each pixel averaging up to 4 from the level above
+static void downsample(const std::vector<unsigned char>& level, unsigned int w, unsigned int h, unsigned int channels,
+					   std::vector<unsigned char>& next) {
+
+	unsigned int nw = levelSize(w, 1);
+	unsigned int nh = levelSize(h, 1);
+	next.resize((size_t)nw * nh * channels);
+	for (unsigned int y = 0; y < nh; ++y) {
+		unsigned int y0 = y * 2, y1 = y * 2 + 1 < h ? y * 2 + 1 : y * 2;
+		for (unsigned int x = 0; x < nw; ++x) {
+			unsigned int x0 = x * 2, x1 = x * 2 + 1 < w ? x * 2 + 1 : x * 2;
+			for (unsigned int c = 0; c < channels; ++c) {
+				unsigned int sum = level[((size_t)y0 * w + x0) * channels + c] + level[((size_t)y0 * w + x1) * channels + c] +
+								   level[((size_t)y1 * w + x0) * channels + c] + level[((size_t)y1 * w + x1) * channels + c];
+				next[((size_t)y * nw + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+// compresses the 4x4 blocks in rows [firstRow, lastRow) of blocks, with the edge pixels
+// repeated to fill partial blocks
+static void compressBlocks(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+						   Texture::Compression compression, unsigned char* dest, unsigned int firstRow, unsigned int lastRow) {
+
+	unsigned int blockBytes = compression == Texture::BC1 || compression == Texture::BC4 ? 8 : 16;
+	unsigned int blocksWide = (width + 3) / 4;
+	dest += (size_t)firstRow * blocksWide * blockBytes;
+
+	unsigned char block[64];
+	for (unsigned int by = firstRow; by < lastRow; ++by) {
+		for (unsigned int bx = 0; bx < blocksWide; ++bx) {
+			for (unsigned int i = 0; i < 16; ++i) {
+				unsigned int x = bx * 4 + (i & 3);
+				unsigned int y = by * 4 + (i >> 2);
+				const unsigned char* p = pixels + ((size_t)(y < height ? y : height - 1) * width +
+												   (x < width ? x : width - 1)) * channels;
+
+				// grey images are spread across red, green and blue as they are when drawn
+				unsigned char* b = block + i * 4;
+				b[0] = p[0];
+				b[1] = channels > 2 ? p[1] : p[0];
+				b[2] = channels > 2 ? p[2] : p[0];
+				b[3] = channels == 4 ? p[3] : channels == 2 ? p[1] : 255;
+			}
+
+			// BC4 and BC5 blocks are the same as BC3's alpha, so the channels are moved into alpha
+			switch (compression) {
+			case Texture::BC1:
+				stb_compress_dxt_block(dest, block, 0, STB_DXT_NORMAL);
+				break;
+			case Texture::BC3:
+				stb_compress_dxt_block(dest, block, 1, STB_DXT_NORMAL);
+				break;
+			case Texture::BC4:
+				for (unsigned int i = 0; i < 16; ++i)
+					block[i * 4 + 3] = block[i * 4];
+				stb__CompressAlphaBlock(dest, block, STB_DXT_NORMAL);
+				break;
+			case Texture::BC5:
+			default: {
+				unsigned char second[64];
+				for (unsigned int i = 0; i < 16; ++i) {
+					second[i * 4 + 3] = channels == 2 ? block[i * 4 + 3] : block[i * 4 + 1];
+					block[i * 4 + 3] = block[i * 4];
+				}
+				stb__CompressAlphaBlock(dest, block, STB_DXT_NORMAL);
+				stb__CompressAlphaBlock(dest + 8, second, STB_DXT_NORMAL);
+				break;
+			}
+			};
+			dest += blockBytes;
+		}
+	}
+}
+
+// block compresses an image and a full chain of box-filtered mipmaps, splitting each level's
+// rows of blocks between threads
+static void compressImage(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+						  Texture::Compression compression, unsigned int threadCount, ImageLevels& image) {
+
+	if (compression == Texture::AUTO_COMPRESS)
+		compression = channels == 1 ? Texture::BC4 : channels == 2 ? Texture::BC5 :
+					  channels == 3 ? Texture::BC1 : Texture::BC3;
+
+	switch (compression) {
+	case Texture::BC1:	image.internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;	image.channels = 3;	break;
+	case Texture::BC3:	image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;	image.channels = 4;	break;
+	case Texture::BC4:	image.internalFormat = GL_COMPRESSED_RED_RGTC1;	image.channels = 1;	break;
+	default:			image.internalFormat = GL_COMPRESSED_RG_RGTC2;	image.channels = 2;	break;
+	};
+	image.format = 0;
+	image.type = 0;
+	image.width = width;
+	image.height = height;
+
+	unsigned int blockBytes = compression == Texture::BC1 || compression == Texture::BC4 ? 8 : 16;
+
+	unsigned int levels = 1;
+	while (levelSize(width, levels - 1) > 1 || levelSize(height, levels - 1) > 1)
+		levels++;
+
+	size_t total = 0;
+	image.offsets.clear();
+	for (unsigned int i = 0; i < levels; ++i) {
+		image.offsets.push_back(total);
+		total += (size_t)((levelSize(width, i) + 3) / 4) * ((levelSize(height, i) + 3) / 4) * blockBytes;
+	}
+	image.offsets.push_back(total);
+	image.data.resize(total);
+
+	std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * channels);
+	std::vector<unsigned char> next;
+
+	for (unsigned int i = 0; i < levels; ++i) {
+		unsigned int w = levelSize(width, i);
+		unsigned int h = levelSize(height, i);
+		unsigned int rows = (h + 3) / 4;
+		unsigned char* dest = image.data.data() + image.offsets[i];
+
+		unsigned int count = threadCount < rows ? threadCount : rows;
+		if (count <= 1)
+			compressBlocks(level.data(), w, h, channels, compression, dest, 0, rows);
+		else {
+			std::vector<std::thread> threads;
+			for (unsigned int t = 0; t < count; ++t)
+				threads.push_back(std::thread(compressBlocks, level.data(), w, h, channels, compression, dest,
+											  rows * t / count, rows * (t + 1) / count));
+			for (auto& thread : threads)
+				thread.join();
+		}
+
+		if (i + 1 == levels)
+			break;
+
+		downsample(level, w, h, channels, next);
+		level.swap(next);
+	}
+}
+
+// the full chain of box-filtered mipmaps for an uncompressed image, with rows tightly packed
+static void buildMipmaps(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+						 ImageLevels& image) {
+
+	switch (channels) {
+	case 1:		image.internalFormat = GL_RED;	break;
+	case 2:		image.internalFormat = GL_RG;	break;
+	case 3:		image.internalFormat = GL_RGB;	break;
+	default:	image.internalFormat = GL_RGBA;	break;
+	};
+	image.format = image.internalFormat;
+	image.type = GL_UNSIGNED_BYTE;
+	image.channels = channels;
+	image.width = width;
+	image.height = height;
+	image.alignment = 1;
+
+	std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * channels);
+	std::vector<unsigned char> next;
+
+	image.data.clear();
+	image.offsets.clear();
+	for (unsigned int i = 0;; ++i) {
+		image.offsets.push_back(image.data.size());
+		image.data.insert(image.data.end(), level.begin(), level.end());
+
+		unsigned int w = levelSize(width, i);
+		unsigned int h = levelSize(height, i);
+		if (w == 1 && h == 1)
+			break;
+
+		downsample(level, w, h, channels, next);
+		level.swap(next);
+	}
+	image.offsets.push_back(image.data.size());
+}
+
+static inline unsigned int readUint(const unsigned char* data) {
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24);
+}
+
+// the channels and bytes per 4x4 block of the compressed formats that can be loaded
+static bool getBlockFormat(unsigned int internalFormat, unsigned int& channels, unsigned int& blockBytes) {
+	switch (internalFormat) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:	channels = 3;	blockBytes = 8;		return true;
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:	channels = 4;	blockBytes = 8;		return true;
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:	channels = 4;	blockBytes = 16;	return true;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:	channels = 4;	blockBytes = 16;	return true;
+	case GL_COMPRESSED_RED_RGTC1:			channels = 1;	blockBytes = 8;		return true;
+	case GL_COMPRESSED_RG_RGTC2:			channels = 2;	blockBytes = 16;	return true;
+	default:	return false;
+	};
+}
+
+// the most mip levels an image of this size can have
+static unsigned int getMaxLevels(unsigned int width, unsigned int height) {
+	unsigned int size = width > height ? width : height;
+	unsigned int levels = 1;
+	while (size > 1) {
+		size >>= 1;
+		levels++;
+	}
+	return levels;
+}
+
+// the bytes a level of the image takes, with rows of plain pixels padded to the alignment,
+// or 0 if the format isn't one that can be loaded
+static size_t getLevelBytes(const ImageLevels& image, unsigned int level) {
+
+	unsigned int w = levelSize(image.width, level);
+	unsigned int h = levelSize(image.height, level);
+
+	if (image.type == 0) {
+		unsigned int channels = 0, blockBytes = 0;
+		if (getBlockFormat(image.internalFormat, channels, blockBytes) == false)
+			return 0;
+		return (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+	}
+
+	unsigned int components = 0, componentBytes = 0;
+	switch (image.format) {
+	case GL_RED:	components = 1;	break;
+	case GL_RG:		components = 2;	break;
+	case GL_RGB:
+	case GL_BGR:	components = 3;	break;
+	case GL_RGBA:
+	case GL_BGRA:	components = 4;	break;
+	default:		return 0;
+	};
+	switch (image.type) {
+	case GL_UNSIGNED_BYTE:
+	case GL_BYTE:			componentBytes = 1;	break;
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:
+	case GL_HALF_FLOAT:		componentBytes = 2;	break;
+	case GL_UNSIGNED_INT:
+	case GL_INT:
+	case GL_FLOAT:			componentBytes = 4;	break;
+	default:				return 0;
+	};
+	if (image.alignment != 1 && image.alignment != 2 &&
+		image.alignment != 4 && image.alignment != 8)
+		return 0;
+
+	size_t row = (size_t)w * components * componentBytes;
+	row = (row + image.alignment - 1) / image.alignment * image.alignment;
+	return row * h;
+}
+
+// reads the block compressed levels from a DDS file, including those with a DX10 header
+static bool parseDDS(const std::vector<unsigned char>& file, ImageLevels& image) {
+
+	if (file.size() < 128 || memcmp(file.data(), "DDS ", 4) != 0)
+		return false;
+
+	const unsigned char* header = file.data() + 4;
+	unsigned int height = readUint(header + 8);
+	unsigned int width = readUint(header + 12);
+	unsigned int levels = readUint(header + 24);
+	const unsigned char* fourCC = header + 80;
+	size_t offset = 128;
+
+	if (memcmp(fourCC, "DXT1", 4) == 0)			image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	else if (memcmp(fourCC, "DXT3", 4) == 0)	image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+	else if (memcmp(fourCC, "DXT5", 4) == 0)	image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	else if (memcmp(fourCC, "ATI1", 4) == 0 ||
+			 memcmp(fourCC, "BC4U", 4) == 0)	image.internalFormat = GL_COMPRESSED_RED_RGTC1;
+	else if (memcmp(fourCC, "ATI2", 4) == 0 ||
+			 memcmp(fourCC, "BC5U", 4) == 0)	image.internalFormat = GL_COMPRESSED_RG_RGTC2;
+	else if (memcmp(fourCC, "DX10", 4) == 0) {
+		if (file.size() < 148)
+			return false;
+
+		// DXGI_FORMAT values
+		switch (readUint(file.data() + 128)) {
+		case 71:	image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;	break;
+		case 74:	image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;	break;
+		case 77:	image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;	break;
+		case 80:	image.internalFormat = GL_COMPRESSED_RED_RGTC1;	break;
+		case 83:	image.internalFormat = GL_COMPRESSED_RG_RGTC2;	break;
+		default:	return false;
+		};
+		offset = 148;
+	}
+	else
+		return false;
+
+	if (width == 0 || height == 0)
+		return false;
+
+	unsigned int blockBytes = 0;
+	getBlockFormat(image.internalFormat, image.channels, blockBytes);
+	image.format = 0;
+	image.type = 0;
+	image.width = width;
+	image.height = height;
+
+	// the count comes from the file, so it's kept within the image's real mip chain
+	unsigned int maxLevels = getMaxLevels(width, height);
+	levels = levels == 0 ? 1 : levels > maxLevels ? maxLevels : levels;
+
+	image.offsets.clear();
+	size_t start = offset;
+	for (unsigned int i = 0; i < levels; ++i) {
+		image.offsets.push_back(offset - start);
+		offset += getLevelBytes(image, i);
+		if (offset > file.size())
+			return false;
+	}
+	image.offsets.push_back(offset - start);
+
+	image.data.assign(file.begin() + start, file.begin() + offset);
+	return true;
+}
+
+// reads the levels of a 2D KTX (version 1) file, compressed or not
+static bool parseKTX(const std::vector<unsigned char>& file, ImageLevels& image) {
+
+	static const unsigned char identifier[] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	if (file.size() < 64 || memcmp(file.data(), identifier, 12) != 0 ||
+		readUint(file.data() + 12) != 0x04030201)
+		return false;
+
+	const unsigned char* header = file.data() + 16;
+	image.type = readUint(header);
+	image.format = readUint(header + 8);
+	image.internalFormat = readUint(header + 12);
+	unsigned int baseFormat = readUint(header + 16);
+	image.width = readUint(header + 20);
+	image.height = readUint(header + 24);
+	unsigned int depth = readUint(header + 28);
+	unsigned int arrayElements = readUint(header + 32);
+	unsigned int faces = readUint(header + 36);
+	unsigned int levels = readUint(header + 40);
+	unsigned int keyValueBytes = readUint(header + 44);
+
+	// 3D, array and cube map textures lay their levels out differently
+	if (depth != 0 || arrayElements != 0 || faces != 1)
+		return false;
+
+	if (image.type == 0) {
+		unsigned int blockBytes = 0;
+		if (getBlockFormat(image.internalFormat, image.channels, blockBytes) == false)
+			return false;
+	}
+	else {
+		switch (baseFormat) {
+		case GL_RED:	image.channels = 1;	break;
+		case GL_RG:		image.channels = 2;	break;
+		case GL_RGB:	image.channels = 3;	break;
+		case GL_RGBA:	image.channels = 4;	break;
+		default:		return false;
+		};
+	}
+
+	if (image.width == 0 || image.height == 0)
+		return false;
+
+	unsigned int maxLevels = getMaxLevels(image.width, image.height);
+	levels = levels == 0 ? 1 : levels > maxLevels ? maxLevels : levels;
+
+	// each level's size comes before it, and levels are padded to 4 bytes. rows of plain
+	// pixels are padded to 4 bytes too
+	size_t offset = 64 + (size_t)keyValueBytes;
+	image.data.clear();
+	image.offsets.clear();
+	for (unsigned int i = 0; i < levels; ++i) {
+		if (offset + 4 > file.size())
+			return false;
+		size_t size = readUint(file.data() + offset);
+		offset += 4;
+		if (offset + size > file.size() ||
+			size != getLevelBytes(image, i))
+			return false;
+
+		image.offsets.push_back(image.data.size());
+		image.data.insert(image.data.end(), file.begin() + offset, file.begin() + offset + size);
+		offset += (size + 3) & ~(size_t)3;
+	}
+	image.offsets.push_back(image.data.size());
+	return true;
+}
+
+// cooked textures start with this header, followed by the offset of each level from the start of
+// the file and then the end of the last, all as 64-bit values. the levels are in their final GPU
+// format so that they can be copied straight from a memory-mapped file into a pixel-unpack buffer
+struct CookedHeader {
+	char			magic[4];
+	unsigned int	version;
+	unsigned int	width, height;
+	unsigned int	levels;
+
+	// the type is 0 for compressed levels
+	unsigned int	internalFormat;
+	unsigned int	format;
+	unsigned int	type;
+
+	unsigned int	channels;
+	unsigned int	alignment;
+	unsigned int	reserved[2];
+};
+
+static const unsigned int COOKED_VERSION = 1;
+
+// levels start on a 16 byte boundary
+static const size_t COOKED_ALIGNMENT = 16;
+
+// points the image at the levels within a mapped cooked file
+static bool parseCooked(const MappedFile& file, ImageLevels& image) {
+
+	CookedHeader header;
+	if (file.size < sizeof(CookedHeader))
+		return false;
+	memcpy(&header, file.data, sizeof(CookedHeader));
+
+	if (memcmp(header.magic, "CTEX", 4) != 0 ||
+		header.version != COOKED_VERSION ||
+		header.width == 0 || header.height == 0 ||
+		header.levels == 0 || header.levels > getMaxLevels(header.width, header.height))
+		return false;
+
+	size_t tableEnd = sizeof(CookedHeader) + (header.levels + 1) * sizeof(unsigned long long);
+	if (file.size < tableEnd)
+		return false;
+
+	unsigned long long offsets[33];
+	memcpy(offsets, file.data + sizeof(CookedHeader), (header.levels + 1) * sizeof(unsigned long long));
+	if (offsets[0] < tableEnd || offsets[header.levels] > file.size)
+		return false;
+
+	image.internalFormat = header.internalFormat;
+	image.format = header.format;
+	image.type = header.type;
+	image.channels = header.channels;
+	image.width = header.width;
+	image.height = header.height;
+	image.alignment = header.alignment;
+
+	// every level must be exactly the size its dimensions and format need, so a truncated or
+	// mismatched file fails here rather than during the upload
+	image.offsets.clear();
+	for (unsigned int i = 0; i <= header.levels; ++i) {
+		if (i < header.levels) {
+			size_t bytes = getLevelBytes(image, i);
+			if (bytes == 0 ||
+				offsets[i + 1] < offsets[i] ||
+				offsets[i + 1] - offsets[i] != bytes)
+				return false;
+		}
+		image.offsets.push_back((size_t)(offsets[i] - offsets[0]));
+	}
+
+	image.data.clear();
+	image.mapped = file.data + offsets[0];
+	return true;
+}
+
+// compares the file's extension, ignoring case
+static bool hasExtension(const char* filename, const char* extension) {
+	const char* dot = strrchr(filename, '.');
+	if (dot == nullptr)
+		return false;
+
+	for (; *dot != 0 && *extension != 0; ++dot, ++extension)
+		if (tolower((unsigned char)*dot) != *extension)
+			return false;
+	return *dot == 0 && *extension == 0;
+}
+
+// fopen_s where it's available, to keep the MSVC runtime happy
+static FILE* openFile(const char* filename, const char* mode) {
+	FILE* file = nullptr;
+#ifdef _WIN32
+	fopen_s(&file, filename, mode);
+#else
+	file = fopen(filename, mode);
+#endif
+	return file;
+}
+
+static bool isCooked(const char* filename) {
+	return hasExtension(filename, ".ctex");
+}
+
+// DDS and KTX files are loaded as they are rather than through stb_image
+static bool isContainer(const char* filename) {
+	return hasExtension(filename, ".dds") || hasExtension(filename, ".ktx");
+}
+
+static bool loadContainer(const char* filename, ImageLevels& image) {
+
+	FILE* file = openFile(filename, "rb");
+	if (file == nullptr)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	std::vector<unsigned char> data(size > 0 ? size : 0);
+	size_t read = fread(data.data(), 1, data.size(), file);
+	fclose(file);
+	if (read != data.size())
+		return false;
+
+	return hasExtension(filename, ".dds") ? parseDDS(data, image) : parseKTX(data, image);
+}
+
+// uploads every level to the bound texture, with the data either in memory or, when null, in the
+// bound pixel-unpack buffer
+static void uploadLevels(const ImageLevels& image, const unsigned char* data) {
+
+	if (image.type != 0)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, image.alignment);
+
+	unsigned int levels = (unsigned int)image.offsets.size() - 1;
+	for (unsigned int i = 0; i < levels; ++i) {
+		unsigned int w = levelSize(image.width, i);
+		unsigned int h = levelSize(image.height, i);
+		const unsigned char* level = data + image.offsets[i];
+
+		if (image.type == 0)
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, image.internalFormat, w, h, 0,
+								   (GLsizei)(image.offsets[i + 1] - image.offsets[i]), level);
+		else
+			glTexImage2D(GL_TEXTURE_2D, i, image.internalFormat, w, h, 0, image.format, image.type, level);
+	}
+
+	// back to OpenGL's default
+	if (image.type != 0)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+}
+
+// creates a texture from the levels, copied through a pixel-unpack buffer
+static unsigned int uploadImage(const ImageLevels& image) {
+
+	unsigned int pixelBuffer = 0;
+	glGenBuffers(1, &pixelBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, image.getSize(), image.getData(), GL_STREAM_DRAW);
+
+	unsigned int handle = 0;
+	glGenTextures(1, &handle);
+	glBindTexture(GL_TEXTURE_2D, handle);
+	uploadLevels(image, nullptr);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &pixelBuffer);
+	return handle;
+}
+
+// a file decoded on a worker then uploaded on the main thread. the texture is cleared if it's
+// deleted or reloaded first, and the load is then thrown away once the workers are done with it
+struct Texture::AsyncLoad {
+	Texture*		texture;
+	std::string		filename;
+	Compression		compression;
+
+	// written by a worker, and read once decoded is set. the image has the levels
+	// when the file was cooked, a container or was compressed, and cooked levels are
+	// read from the mapped file
+	unsigned char*	pixels;
+	int				width, height, components;
+	ImageLevels		image;
+	MappedFile		file;
+
+	// guarded by the pool's mutex
+	bool			decoded;
+	bool			cancelled;
+
+	unsigned int	handle;
+	unsigned int	pixelBuffer;
+	GLsync			fence;
+};
+
+// worker threads decode queued loads, one per spare core, while every load in flight is tracked
+// on the main thread until it is swapped in or abandoned
+struct Texture::AsyncPool {
+	std::vector<std::thread>	workers;
+	std::deque<AsyncLoad*>		queue;
+	std::mutex					mutex;
+	std::condition_variable		wake;
+	bool						stopping;
+
+	std::vector<AsyncLoad*>		loads;
+	unsigned int				placeholder;
+
+	AsyncPool();
+	~AsyncPool();
+
+	void work();
+};
+
+Texture::AsyncPool* Texture::sm_asyncPool = nullptr;
+
+Texture::AsyncPool::AsyncPool()
+	: stopping(false),
+	placeholder(0) {
+
+	unsigned int count = std::thread::hardware_concurrency();
+	count = count > 1 ? count - 1 : 1;
+	for (unsigned int i = 0; i < count; ++i)
+		workers.push_back(std::thread(&AsyncPool::work, this));
+
+	// a magenta and black checker, easy to spot if it's left in place
+	unsigned char pixels[] = { 255, 0, 255, 255,  0, 0, 0, 255,
+							   0, 0, 0, 255,  255, 0, 255, 255 };
+	glGenTextures(1, &placeholder);
+	glBindTexture(GL_TEXTURE_2D, placeholder);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+Texture::AsyncPool::~AsyncPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers)
+		worker.join();
+
+	for (auto load : loads) {
+		if (load->texture != nullptr) {
+			load->texture->m_asyncLoad = nullptr;
+			load->texture->m_glHandle = 0;
+		}
+		if (load->fence != nullptr)
+			glDeleteSync(load->fence);
+		if (load->pixelBuffer != 0)
+			glDeleteBuffers(1, &load->pixelBuffer);
+		if (load->handle != 0)
+			glDeleteTextures(1, &load->handle);
+		if (load->pixels != nullptr)
+			stbi_image_free(load->pixels);
+		delete load;
+	}
+
+	glDeleteTextures(1, &placeholder);
+}
+
+void Texture::AsyncPool::work() {
+	for (;;) {
+		AsyncLoad* load = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || queue.empty() == false; });
+			if (stopping)
+				return;
+
+			load = queue.front();
+			queue.pop_front();
+
+			// no point decoding something nobody wants
+			if (load->cancelled) {
+				load->decoded = true;
+				continue;
+			}
+		}
+
+		// each worker compresses its own image, so the pool already keeps the cores busy
+		if (isCooked(load->filename.c_str())) {
+			if (load->file.open(load->filename.c_str()) &&
+				parseCooked(load->file, load->image)) {
+				// reading the file here keeps the disk off the main thread
+				load->file.prefetch();
+				load->width = load->image.width;
+				load->height = load->image.height;
+				load->components = load->image.channels;
+			}
+			else
+				load->image.offsets.clear();
+		}
+		else if (isContainer(load->filename.c_str())) {
+			if (loadContainer(load->filename.c_str(), load->image)) {
+				load->width = load->image.width;
+				load->height = load->image.height;
+				load->components = load->image.channels;
+			}
+			else
+				load->image.offsets.clear();
+		}
+		else {
+			load->pixels = stbi_load(load->filename.c_str(), &load->width, &load->height, &load->components, STBI_default);
+			if (load->pixels != nullptr &&
+				load->compression != UNCOMPRESSED) {
+				compressImage(load->pixels, load->width, load->height, load->components, load->compression, 1, load->image);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		load->decoded = true;
+	}
+}
+
+// the bytes used by an uncompressed texture and its mipmaps, each level a quarter of the last
+static size_t getMipmappedSize(unsigned int width, unsigned int height, unsigned int bytesPerPixel) {
+	size_t bytes = (size_t)width * height * bytesPerPixel;
+	while (width > 1 || height > 1) {
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		bytes += (size_t)width * height * bytesPerPixel;
+	}
+	return bytes;
+}
+
+// the OpenGL format for each of the image's component counts
+static unsigned int getGLFormat(int components) {
+	switch (components) {
+	case STBI_grey:			return GL_RED;
+	case STBI_grey_alpha:	return GL_RG;
+	case STBI_rgb:			return GL_RGB;
+	default:				return GL_RGBA;
+	};
+}
+
 Texture::Texture() 
 	: m_filename("none"),
 	m_width(0),
 	m_height(0),
 	m_glHandle(0),
 	m_format(0),
-	m_loadedPixels(nullptr) {
+	m_loadedPixels(nullptr),
+	m_memoryUsage(0),
+	m_asyncLoad(nullptr) {
 }
 
 Texture::Texture(const char * filename)
@@ -21,7 +910,9 @@ Texture::Texture(const char * filename)
 	m_height(0),
 	m_glHandle(0),
 	m_format(0),
-	m_loadedPixels(nullptr) {
+	m_loadedPixels(nullptr),
+	m_memoryUsage(0),
+	m_asyncLoad(nullptr) {
 
 	load(filename);
 }
@@ -31,31 +922,77 @@ Texture::Texture(unsigned int width, unsigned int height, Format format, unsigne
 	m_width(width),
 	m_height(height),
 	m_format(format),
-	m_loadedPixels(nullptr) {
+	m_loadedPixels(nullptr),
+	m_memoryUsage(0),
+	m_asyncLoad(nullptr) {
 
 	create(width, height, format, pixels);
 }
 
 Texture::~Texture() {
+	cancelAsyncLoad();
 	if (m_glHandle != 0)
 		glDeleteTextures(1, &m_glHandle);
 	if (m_loadedPixels != nullptr)
 		stbi_image_free(m_loadedPixels);
 }
 
-bool Texture::load(const char* filename) {
+bool Texture::load(const char* filename, Compression compression) {
 
+	cancelAsyncLoad();
 	if (m_glHandle != 0) {
 		glDeleteTextures(1, &m_glHandle);
 		m_glHandle = 0;
 		m_width = 0;
 		m_height = 0;
+		m_memoryUsage = 0;
 		m_filename = "none";
 	}
+	if (m_loadedPixels != nullptr) {
+		stbi_image_free(m_loadedPixels);
+		m_loadedPixels = nullptr;
+	}
+
+	// cooked and pre-compressed files are uploaded as they are, with cooked levels going
+	// from the mapped file straight into a pixel-unpack buffer without being decoded
+	if (isCooked(filename) ||
+		isContainer(filename)) {
+		ImageLevels image;
+		MappedFile file;
+		bool loaded = isCooked(filename) ? file.open(filename) && parseCooked(file, image) :
+										   loadContainer(filename, image);
+		if (loaded == false)
+			return false;
+
+		m_glHandle = uploadImage(image);
+		m_format = image.channels;
+		m_width = image.width;
+		m_height = image.height;
+		m_memoryUsage = image.getSize();
+		m_filename = filename;
+		return true;
+	}
 
 	int x = 0, y = 0, comp = 0;
 	m_loadedPixels = stbi_load(filename, &x, &y, &comp, STBI_default);
 
+	if (m_loadedPixels != nullptr &&
+		compression != UNCOMPRESSED) {
+		unsigned int threads = std::thread::hardware_concurrency();
+
+		ImageLevels image;
+		compressImage(m_loadedPixels, x, y, comp, compression, threads > 0 ? threads : 1, image);
+
+		// the format describes the decoded pixels kept by the texture, not the compressed copy
+		m_glHandle = uploadImage(image);
+		m_format = (unsigned int)comp;
+		m_width = (unsigned int)x;
+		m_height = (unsigned int)y;
+		m_memoryUsage = image.getSize();
+		m_filename = filename;
+		return true;
+	}
+
 	if (m_loadedPixels != nullptr) {
 		glGenTextures(1, &m_glHandle);
 		glBindTexture(GL_TEXTURE_2D, m_glHandle);
@@ -88,6 +1025,7 @@ bool Texture::load(const char* filename) {
 		glBindTexture(GL_TEXTURE_2D, 0);
 		m_width = (unsigned int)x;
 		m_height = (unsigned int)y;
+		m_memoryUsage = getMipmappedSize(m_width, m_height, m_format);
 		m_filename = filename;
 		return true;
 	}
@@ -96,6 +1034,7 @@ bool Texture::load(const char* filename) {
 
 void Texture::create(unsigned int width, unsigned int height, Format format, unsigned char* pixels) {
 
+	cancelAsyncLoad();
 	if (m_glHandle != 0) {
 		glDeleteTextures(1, &m_glHandle);
 		m_glHandle = 0;
@@ -105,6 +1044,7 @@ void Texture::create(unsigned int width, unsigned int height, Format format, uns
 	m_width = width;
 	m_height = height;
 	m_format = format;
+	m_memoryUsage = (size_t)width * height * format;
 
 	glGenTextures(1, &m_glHandle);
 	glBindTexture(GL_TEXTURE_2D, m_glHandle);
@@ -133,9 +1073,239 @@ void Texture::create(unsigned int width, unsigned int height, Format format, uns
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+
 void Texture::bind(unsigned int slot) const {
 	glActiveTexture(GL_TEXTURE0 + slot);
 	glBindTexture(GL_TEXTURE_2D, m_glHandle);
 }
 
+void Texture::loadAsync(const char* filename, Compression compression) {
+
+	// starts empty, like load()
+	cancelAsyncLoad();
+	if (m_glHandle != 0) {
+		glDeleteTextures(1, &m_glHandle);
+		m_glHandle = 0;
+	}
+	if (m_loadedPixels != nullptr) {
+		stbi_image_free(m_loadedPixels);
+		m_loadedPixels = nullptr;
+	}
+	m_width = 0;
+	m_height = 0;
+	m_memoryUsage = 0;
+	m_filename = "none";
+
+	if (sm_asyncPool == nullptr)
+		sm_asyncPool = new AsyncPool();
+
+	AsyncLoad* load = new AsyncLoad();
+	load->texture = this;
+	load->filename = filename;
+	load->compression = compression;
+	load->pixels = nullptr;
+	load->width = 0;
+	load->height = 0;
+	load->components = 0;
+	load->decoded = false;
+	load->cancelled = false;
+	load->handle = 0;
+	load->pixelBuffer = 0;
+	load->fence = nullptr;
+
+	m_asyncLoad = load;
+	m_glHandle = sm_asyncPool->placeholder;
+
+	sm_asyncPool->loads.push_back(load);
+	{
+		std::lock_guard<std::mutex> lock(sm_asyncPool->mutex);
+		sm_asyncPool->queue.push_back(load);
+	}
+	sm_asyncPool->wake.notify_one();
+}
+
+void Texture::cancelAsyncLoad() {
+	if (m_asyncLoad == nullptr)
+		return;
+
+	// the pool frees it once the workers and GPU are done with it
+	std::lock_guard<std::mutex> lock(sm_asyncPool->mutex);
+	m_asyncLoad->cancelled = true;
+	m_asyncLoad->texture = nullptr;
+	m_asyncLoad = nullptr;
+
+	// the placeholder is shared
+	m_glHandle = 0;
+}
+
+void Texture::updateAsyncLoads(unsigned int maxBytes) {
+	if (sm_asyncPool == nullptr)
+		return;
+
+	auto& loads = sm_asyncPool->loads;
+
+	// the loads that have finished decoding
+	std::vector<bool> decoded(loads.size());
+	{
+		std::lock_guard<std::mutex> lock(sm_asyncPool->mutex);
+		for (size_t i = 0; i < loads.size(); ++i)
+			decoded[i] = loads[i]->decoded;
+	}
+
+	// at least one upload is always made, so large images still get through
+	unsigned int uploaded = 0;
+	size_t kept = 0;
+	for (size_t i = 0; i < loads.size(); ++i) {
+		AsyncLoad* load = loads[i];
+		Texture* texture = load->texture;
+		bool finished = false;
+
+		if (load->fence != nullptr) {
+			GLenum result = glClientWaitSync(load->fence, 0, 0);
+			if (result == GL_ALREADY_SIGNALED ||
+				result == GL_CONDITION_SATISFIED) {
+				glDeleteSync(load->fence);
+				glDeleteBuffers(1, &load->pixelBuffer);
+
+				if (texture != nullptr) {
+					texture->m_glHandle = load->handle;
+					texture->m_width = (unsigned int)load->width;
+					texture->m_height = (unsigned int)load->height;
+					texture->m_format = (unsigned int)load->components;
+					texture->m_memoryUsage = load->image.offsets.empty() ?
+						getMipmappedSize(load->width, load->height, load->components) : load->image.getSize();
+					texture->m_filename = load->filename;
+					texture->m_loadedPixels = load->pixels;
+					texture->m_asyncLoad = nullptr;
+				}
+				else {
+					glDeleteTextures(1, &load->handle);
+					stbi_image_free(load->pixels);
+				}
+				finished = true;
+			}
+		}
+		else if (decoded[i]) {
+			if (texture == nullptr ||
+				(load->pixels == nullptr && load->image.offsets.empty())) {
+				if (texture != nullptr) {
+					texture->m_glHandle = 0;
+					texture->m_asyncLoad = nullptr;
+				}
+				if (load->pixels != nullptr)
+					stbi_image_free(load->pixels);
+				finished = true;
+			}
+			else {
+				const ImageLevels& image = load->image;
+				unsigned int size = image.offsets.empty() ? load->width * load->height * load->components :
+															(unsigned int)image.getSize();
+				if (uploaded == 0 || uploaded + size <= maxBytes) {
+					uploaded += size;
+
+					// the copy from the buffer to the texture, and the mipmaps, happen on the GPU
+					// while the placeholder is still in use
+					glGenBuffers(1, &load->pixelBuffer);
+					glBindBuffer(GL_PIXEL_UNPACK_BUFFER, load->pixelBuffer);
+					glGenTextures(1, &load->handle);
+					glBindTexture(GL_TEXTURE_2D, load->handle);
+
+					// compressed and container images bring their own mipmaps
+					if (image.offsets.empty()) {
+						glBufferData(GL_PIXEL_UNPACK_BUFFER, size, load->pixels, GL_STREAM_DRAW);
+
+						// decoded rows are tightly packed, so rows of grey or RGB pixels
+						// needn't be a multiple of 4 bytes
+						unsigned int format = getGLFormat(load->components);
+						glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+						glTexImage2D(GL_TEXTURE_2D, 0, format, load->width, load->height,
+									 0, format, GL_UNSIGNED_BYTE, 0);
+						glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+						glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+						glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+						glGenerateMipmap(GL_TEXTURE_2D);
+					}
+					else {
+						glBufferData(GL_PIXEL_UNPACK_BUFFER, size, image.getData(), GL_STREAM_DRAW);
+						uploadLevels(image, nullptr);
+
+						// the buffer has its own copy now
+						load->file.close();
+					}
+					glBindTexture(GL_TEXTURE_2D, 0);
+					glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+					load->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				}
+			}
+		}
+
+		if (finished)
+			delete load;
+		else
+			loads[kept++] = load;
+	}
+	loads.resize(kept);
+}
+
+bool Texture::cook(const char* source, const char* destination, Compression compression) {
+
+	ImageLevels image;
+	if (isContainer(source)) {
+		if (loadContainer(source, image) == false)
+			return false;
+	}
+	else {
+		int x = 0, y = 0, comp = 0;
+		unsigned char* pixels = stbi_load(source, &x, &y, &comp, STBI_default);
+		if (pixels == nullptr)
+			return false;
+
+		if (compression != UNCOMPRESSED) {
+			unsigned int threads = std::thread::hardware_concurrency();
+			compressImage(pixels, x, y, comp, compression, threads > 0 ? threads : 1, image);
+		}
+		else
+			buildMipmaps(pixels, x, y, comp, image);
+		stbi_image_free(pixels);
+	}
+
+	CookedHeader header;
+	memset(&header, 0, sizeof(CookedHeader));
+	memcpy(header.magic, "CTEX", 4);
+	header.version = COOKED_VERSION;
+	header.width = image.width;
+	header.height = image.height;
+	header.levels = (unsigned int)image.offsets.size() - 1;
+	header.internalFormat = image.internalFormat;
+	header.format = image.format;
+	header.type = image.type;
+	header.channels = image.channels;
+	header.alignment = image.alignment;
+
+	size_t tableEnd = sizeof(CookedHeader) + image.offsets.size() * sizeof(unsigned long long);
+	size_t start = (tableEnd + COOKED_ALIGNMENT - 1) & ~(COOKED_ALIGNMENT - 1);
+
+	std::vector<unsigned long long> offsets;
+	for (auto offset : image.offsets)
+		offsets.push_back(start + offset);
+
+	FILE* file = openFile(destination, "wb");
+	if (file == nullptr)
+		return false;
+
+	unsigned char padding[COOKED_ALIGNMENT] = {};
+	bool written = fwrite(&header, sizeof(CookedHeader), 1, file) == 1 &&
+				   fwrite(offsets.data(), sizeof(unsigned long long), offsets.size(), file) == offsets.size() &&
+				   fwrite(padding, 1, start - tableEnd, file) == start - tableEnd &&
+				   fwrite(image.getData(), 1, image.getSize(), file) == image.getSize();
+	fclose(file);
+	return written;
+}
+
+void Texture::stopAsyncLoads() {
+	delete sm_asyncPool;
+	sm_asyncPool = nullptr;
+}
+
 } // namespace aie
\ No newline at end of file
@@ -15,13 +15,48 @@ public:
 		RGBA
 	};
 
+	// block compression for images, with AUTO_COMPRESS picking BC4 for one channel, BC5 for two
+	// (such as normal maps), BC1 for RGB and BC3 for RGBA. BC1 uses 4 bits per pixel and the rest 8
+	enum Compression : unsigned int {
+		UNCOMPRESSED,
+		AUTO_COMPRESS,
+		BC1,
+		BC3,
+		BC4,
+		BC5
+	};
+
 	Texture();
 	Texture(const char* filename);
 	Texture(unsigned int width, unsigned int height, Format format, unsigned char* pixels = nullptr);
 	virtual ~Texture();
 
-	// load a jpg, bmp, png or tga
-	bool load(const char* filename);
+	// load a jpg, bmp, png or tga, optionally block compressing it and its mipmaps across all
+	// cores, or a dds, ktx or cooked ctex file which is uploaded as it is. ctex files are
+	// memory-mapped and need no decoding, so they load as fast as the disk can read them
+	bool load(const char* filename, Compression compression = UNCOMPRESSED);
+
+	// converts an image, dds or ktx file into a ctex file holding every mip level in its final
+	// GPU format, compressed first if asked. returns false if the source can't be read or the
+	// destination written
+	static bool cook(const char* source, const char* destination, Compression compression = UNCOMPRESSED);
+
+	// starts loading a file like load(), decoded and compressed by a pool of worker threads. a shared
+	// placeholder texture is bound in its place until it's uploaded, and the size is 0 until then.
+	// the texture is left empty if the file fails to load
+	void loadAsync(const char* filename, Compression compression = UNCOMPRESSED);
+
+	// true until an asynchronous load has finished or failed
+	bool isLoading() const { return m_asyncLoad != nullptr; }
+
+	// uploads decoded textures through pixel-unpack buffers, moving at most maxBytes of pixels
+	// per call so that many finishing at once don't stall a frame, and swaps in those whose
+	// upload has completed. Application calls this every frame
+	static void updateAsyncLoads(unsigned int maxBytes = 32 * 1024 * 1024);
+
+	// stops the worker threads and abandons unfinished loads. Application calls this before
+	// the window closes, while the GL objects can still be deleted
+	static void stopAsyncLoads();
 
 	// creates a texture that can be filled in with pixels
 	void create(unsigned int width, unsigned int height, Format format, unsigned char* pixels = nullptr);
@@ -37,17 +72,32 @@ public:
 
 	unsigned int getWidth() const { return m_width; }
 	unsigned int getHeight() const { return m_height; }
+	// the pixels decoded from an image file, with the format giving their layout. compressed
+	// textures keep the decoded pixels, while dds, ktx and ctex files have none
 	unsigned int getFormat() const { return m_format; }
 	const unsigned char* getPixels() const { return m_loadedPixels; }
 
+	// the video memory the texture uses in bytes, including mipmaps
+	size_t getMemoryUsage() const { return m_memoryUsage; }
+
 protected:
 
+	struct AsyncLoad;
+	struct AsyncPool;
+
+	void cancelAsyncLoad();
+
 	std::string		m_filename;
 	unsigned int	m_width;
 	unsigned int	m_height;
 	unsigned int	m_glHandle;
 	unsigned int	m_format;
 	unsigned char*	m_loadedPixels;
+	size_t			m_memoryUsage;
+
+	AsyncLoad*		m_asyncLoad;
+
+	static AsyncPool*	sm_asyncPool;
 };
 
 } // namespace aie
\ No newline at end of file
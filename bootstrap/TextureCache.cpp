@@ -0,0 +1,188 @@
+#include "TextureCache.h"
+#include "Texture.h"
+#include <ctype.h>
+#include <stdio.h>
+
+namespace aie {
+
+TextureCache::TextureCache(size_t budget)
+	: m_budget(budget) {
+}
+
+TextureCache::~TextureCache() {
+	for (auto& entry : m_entries) {
+		if (entry.second.references > 0)
+			printf("Warning: TextureCache deleted while \"%s\" still has %u references!\n",
+				   entry.first.c_str(), entry.second.references);
+		delete entry.second.texture;
+	}
+}
+
+std::string TextureCache::normalisePath(const char* path) {
+
+	// split into parts, dropping empty and "." parts, and resolving ".." where possible
+	std::vector<std::string> parts;
+	std::string part;
+	for (const char* c = path; ; ++c) {
+		if (*c == '/' || *c == '\\' || *c == 0) {
+			if (part == "..") {
+				if (parts.empty() == false && parts.back() != "..")
+					parts.pop_back();
+				else
+					parts.push_back(part);
+			}
+			else if (part.empty() == false && part != ".")
+				parts.push_back(part);
+			part.clear();
+
+			if (*c == 0)
+				break;
+		}
+#ifdef _WIN32
+		// only Windows file names ignore case
+		else
+			part += (char)tolower((unsigned char)*c);
+#else
+		else
+			part += *c;
+#endif
+	}
+
+	// absolute paths keep their leading slash
+	std::string result = path[0] == '/' || path[0] == '\\' ? "/" : "";
+	for (size_t i = 0; i < parts.size(); ++i) {
+		if (i > 0)
+			result += '/';
+		result += parts[i];
+	}
+	return result;
+}
+
+Texture* TextureCache::acquire(const char* filename, bool async, Texture::Compression compression) {
+
+	std::string path = normalisePath(filename);
+
+	auto iter = m_entries.find(path);
+	if (iter != m_entries.end()) {
+		Entry& entry = iter->second;
+
+		// the texture is reloaded in place, as others may still be holding it
+		if (hasFailed(entry.texture)) {
+			if (async)
+				entry.texture->loadAsync(filename, compression);
+			else if (entry.texture->load(filename, compression) == false) {
+				if (entry.references == 0)
+					remove(iter);
+				return nullptr;
+			}
+		}
+
+		if (entry.references == 0)
+			m_unused.erase(entry.unused);
+		entry.references++;
+		return entry.texture;
+	}
+
+	Texture* texture = new Texture();
+	if (async)
+		texture->loadAsync(filename, compression);
+	else if (texture->load(filename, compression) == false) {
+		delete texture;
+		return nullptr;
+	}
+
+	Entry& entry = m_entries[path];
+	entry.texture = texture;
+	entry.references = 1;
+	m_paths[texture] = path;
+
+	return texture;
+}
+
+void TextureCache::release(Texture* texture) {
+
+	auto path = m_paths.find(texture);
+	if (path == m_paths.end())
+		return;
+
+	Entry& entry = m_entries[path->second];
+	if (entry.references == 0 ||
+		--entry.references > 0)
+		return;
+
+	// kept in case it's wanted again
+	entry.unused = m_unused.insert(m_unused.end(), path->second);
+	trim();
+}
+
+void TextureCache::setBudget(size_t budget) {
+	m_budget = budget;
+	trim();
+}
+
+void TextureCache::purge() {
+	size_t budget = m_budget;
+	m_budget = 0;
+	trim();
+	m_budget = budget;
+}
+
+void TextureCache::remove(std::map<std::string, Entry>::iterator entry) {
+	if (entry->second.references == 0)
+		m_unused.erase(entry->second.unused);
+	m_paths.erase(entry->second.texture);
+	delete entry->second.texture;
+	m_entries.erase(entry);
+}
+
+void TextureCache::trim() {
+
+	// failed loads are never wanted again
+	for (auto iter = m_unused.begin(); iter != m_unused.end();) {
+		auto entry = m_entries.find(*iter++);
+		if (hasFailed(entry->second.texture))
+			remove(entry);
+	}
+
+	// summed each time, as textures still loading have no size yet
+	size_t unusedBytes = 0;
+	for (auto& path : m_unused)
+		unusedBytes += m_entries[path].texture->getMemoryUsage();
+
+	// textures still loading wait for the next trim, unless purging
+	auto iter = m_unused.begin();
+	while (unusedBytes > m_budget &&
+		   iter != m_unused.end()) {
+		auto entry = m_entries.find(*iter);
+		Texture* texture = entry->second.texture;
+		if (m_budget > 0 &&
+			texture->isLoading()) {
+			++iter;
+			continue;
+		}
+
+		unusedBytes -= texture->getMemoryUsage();
+		++iter;
+		remove(entry);
+	}
+}
+
+void TextureCache::getUsage(std::vector<Usage>& usage) const {
+	usage.clear();
+	for (auto& entry : m_entries) {
+		Usage u;
+		u.path = entry.first;
+		u.references = entry.second.references;
+		u.bytes = entry.second.texture->getMemoryUsage();
+		usage.push_back(u);
+	}
+}
+
+size_t TextureCache::getMemoryUsage() const {
+	size_t total = 0;
+	for (auto& entry : m_entries)
+		total += entry.second.texture->getMemoryUsage();
+	return total;
+}
+
+} // namespace aie
\ No newline at end of file
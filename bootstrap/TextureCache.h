@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Texture.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+
+namespace aie {
+
+// shares textures loaded from files, so each file is only decoded and uploaded once however many
+// times it's asked for. paths are normalised first, so "./textures/ship.png" and
+// "textures\ship.png" are the same texture, and on Windows so is "textures/Ship.png". textures are reference counted, and ones that are no
+// longer used are kept until the unused textures take up more than the budget, when the least
+// recently released are deleted first
+class TextureCache {
+public:
+
+	// budget is the most memory, in bytes, that unused textures may keep.
+	// textures still referenced when the cache is deleted are deleted too, with a warning
+	TextureCache(size_t budget = 64 * 1024 * 1024);
+	~TextureCache();
+
+	// returns the texture for a file, adding a reference that must be released, or nullptr if
+	// the file can't be loaded. async textures are loaded with Texture::loadAsync(), and asking
+	// again while one is still loading returns the same texture rather than loading it twice.
+	// a file whose async load failed is loaded again. the compression is used when the file
+	// is loaded, so a texture already in the cache keeps the compression it was loaded with
+	Texture* acquire(const char* filename, bool async = false,
+					 Texture::Compression compression = Texture::UNCOMPRESSED);
+
+	// removes a reference to a texture from acquire()
+	void release(Texture* texture);
+
+	// deletes unused textures until they fit within the budget
+	void setBudget(size_t budget);
+	size_t getBudget() const { return m_budget; }
+
+	// deletes all unused textures
+	void purge();
+
+	struct Usage {
+		std::string		path;
+		unsigned int	references;
+		size_t			bytes;
+	};
+
+	// the memory used by each texture in the cache, and in total
+	void getUsage(std::vector<Usage>& usage) const;
+	size_t getMemoryUsage() const;
+
+	// forward slashes, without "." or resolvable ".." parts, and lower case on Windows
+	static std::string normalisePath(const char* path);
+
+protected:
+
+	struct Entry {
+		Texture*		texture;
+		unsigned int	references;
+
+		// position in the unused list when there are no references
+		std::list<std::string>::iterator	unused;
+	};
+
+	void trim();
+	void remove(std::map<std::string, Entry>::iterator entry);
+
+	// true once an async load has failed, leaving the texture empty
+	static bool hasFailed(const Texture* texture) { return texture->isLoading() == false && texture->getHandle() == 0; }
+
+	std::map<std::string, Entry>	m_entries;
+	std::map<Texture*, std::string>	m_paths;
+
+	// least recently released first
+	std::list<std::string>	m_unused;
+	size_t					m_budget;
+};
+
+} // namespace aie
\ No newline at end of file
@@ -50,17 +50,11 @@ void Application3D::update(float deltaTime) {
 	// wipe the gizmos clean for this frame
 	Gizmos::clear();
 
-	// draw a simple grid with gizmos
-	vec4 white(1);
-	vec4 black(0, 0, 0, 1);
-	for (int i = 0; i < 21; ++i) {
-		Gizmos::addLine(vec3(-10 + i, 0, 10),
-						vec3(-10 + i, 0, -10),
-						i == 10 ? white : black);
-		Gizmos::addLine(vec3(10, 0, -10 + i),
-						vec3(-10, 0, -10 + i),
-						i == 10 ? white : black);
-	}
+	// lets gizmos skip shapes out of view and simplify distant ones
+	Gizmos::setCamera(m_projectionMatrix, m_viewMatrix, (float)getWindowHeight());
+
+	// add a grid on the ground, out to 10 units from the centre
+	Gizmos::addGrid(vec3(0), vec3(0, 1, 0), 1, 10, vec4(0, 0, 0, 1), vec4(1));
 
 	// add a transform so that we can see the axis
 	Gizmos::addTransform(mat4(1));